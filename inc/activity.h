@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   activity.h
+ */
+#ifndef __ACTIVITY_H
+#define __ACTIVITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef void (*activity_notify_t)(bool on);
+
+typedef struct {
+    bool      on;
+    uint32_t  edges;        // CLOCK edges counted since boot
+    uint32_t  last_edges;   // CLOCK edges in the last sample period
+    uint32_t  transitions;  // ON/OFF changes
+    uint32_t  edge_rate;    // CLOCK edges per second, over the last second
+} activity_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void activity_init(void);
+bool activity_is_on(void);
+void activity_resume(void);
+void activity_register_notify_handler(activity_notify_t notify);
+void activity_get_stats(activity_stats_t * stats);
+
+#endif  /* __ACTIVITY_H */
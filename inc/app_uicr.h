@@ -26,6 +26,13 @@ typedef enum{
     EXCLUDE          = 2,  // no standard unit literal
 } standard_t;
 
+typedef enum{
+    INVALID_UNITS    = 0,
+    AS_CALIPER       = 1,  // report in the units the caliper displays
+    ALWAYS_MM        = 2,  // convert inch readings to mm
+    ALWAYS_INCH      = 3,  // convert mm readings to inch
+} units_t;
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -34,5 +41,7 @@ line_end_t app_uicr_get_line_end(void);
 void       app_uicr_set_line_end(line_end_t line_end);
 standard_t app_uicr_get_standard(void);
 void       app_uicr_set_standard(standard_t standard);
+units_t    app_uicr_get_units(void);
+void       app_uicr_set_units(units_t units);
 
 #endif  /* __APP_UICR_H */
\ No newline at end of file
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   autocap.h
+ */
+#ifndef __AUTOCAP_H
+#define __AUTOCAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+/* One settled reading per channel, CALIPER_CHANNELS of each. */
+typedef void (*autocap_notify_t)(const int32_t * values, const int * standards);
+
+typedef struct {
+    bool      enabled;
+    bool      armed;        // jaws have moved since the last capture
+    uint32_t  captures;
+} autocap_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void autocap_reading(const caliper_reading_t * reading);
+void autocap_enable(bool enable);
+void autocap_register_notify_handler(autocap_notify_t notify);
+void autocap_get_stats(autocap_stats_t * stats);
+
+#endif  /* __AUTOCAP_H */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   burst.h
+ */
+#ifndef __BURST_H
+#define __BURST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*  One captured frame, in reading counts (see caliper.h)                    */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t  ms;          // since the burst started
+    int32_t   value;
+    uint8_t   standard;
+    uint8_t   channel;
+} burst_entry_t;
+
+typedef struct {
+    bool      capturing;
+    uint32_t  bursts;      // completed
+    uint32_t  frames;      // in the last (or current) burst
+    uint32_t  overflows;   // frames lost to a full batch, all bursts
+    uint32_t  pending;     // captured, not yet typed
+} burst_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void burst_reading(const caliper_reading_t * reading);
+int  burst_start(void);
+int  burst_stop(void);
+int  burst_entry(int n, burst_entry_t * entry);
+void burst_get_stats(burst_stats_t * stats);
+
+#endif  /* __BURST_H */
@@ -24,6 +24,7 @@ typedef enum {
 } boot_options_t;
 
 typedef void (*buttons_notify_t)(buttons_id_t id);
+typedef void (*buttons_hold_t)(buttons_id_t id, bool held);
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -31,6 +32,7 @@ typedef void (*buttons_notify_t)(buttons_id_t id);
 void buttons_init(void);
 void buttons_register_notify_handler(buttons_notify_t notify);
 void buttons_unregister_notify_handler(void);
+void buttons_register_hold_handler(buttons_hold_t hold);
 void buttons_remote_button(void);
 boot_options_t boot_button_state(void);
 
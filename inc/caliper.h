@@ -4,6 +4,8 @@
 #ifndef __CALIPER_H
 #define __CALIPER_H
 
+#include <zephyr/kernel.h>
+
 /*---------------------------------------------------------------------------*/
 /* Caliper Standards values                                                  */
 /*---------------------------------------------------------------------------*/
@@ -11,10 +13,70 @@
 #define CALIPER_STANDARD_INCH      0x00
 #define CALIPER_STANDARD_MM        0x01
 
+/*
+ *  Readings are fixed point: counts of 0.001 mm or 0.00001 inch, fine
+ *  enough to hold every decoder's native resolution exactly.
+ */
+#define CALIPER_MM_DECIMALS        3
+#define CALIPER_INCH_DECIMALS      5
+
+/* Micrometres to reading counts (0.00001 inch = 0.254 um). */
+#define CALIPER_UM_TO_COUNTS(um, standard)                                   \
+    (((standard) == CALIPER_STANDARD_MM) ? (um) : ((um) * 500) / 127)
+
+/*---------------------------------------------------------------------------*/
+/*  Latest good reading, as published by the caliper thread                  */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    int32_t   value;
+    int       standard;
+    int64_t   timestamp;   // k_uptime_ticks() when decoded
+    uint32_t  seq;         // counts up from 1 with each reading
+} caliper_latest_t;
+
+/*---------------------------------------------------------------------------*/
+/*  Asynchronous read request                                                */
+/*                                                                           */
+/*  Completes once, with a reading or an error, through whichever of         */
+/*  callback, signal and msgq are set.  Completion runs in the caliper       */
+/*  thread, the caliper deadline queue or the canceller's thread.           */
+/*---------------------------------------------------------------------------*/
+
+struct caliper_request;
+
+typedef void (*caliper_callback_t)(struct caliper_request * request);
+
+typedef struct caliper_request {
+    /* Set by the caller */
+    int                      channel;
+    k_timeout_t              timeout;    // deadline, from submission
+    caliper_callback_t       callback;   // or NULL
+    struct k_poll_signal *   signal;     // or NULL; raised with result
+    struct k_msgq *          msgq;       // or NULL; gets the request pointer
+    void *                   user_data;
+
+    /* Result: 0, -ETIMEDOUT, -ECANCELED, or another -errno */
+    int                      result;
+    int32_t                  value;
+    int                      standard;
+
+    /* Private */
+    sys_snode_t              node;
+    struct k_work_delayable  timeout_work;
+    bool                     pending;
+} caliper_request_t;
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 void caliper_init(void);
-int  caliper_read_value(short * value, int * standard);
+int  caliper_read_async(caliper_request_t * request);
+int  caliper_read_cancel(caliper_request_t * request);
+int  caliper_read_value(int32_t * value, int * standard);
+int  caliper_read_channel(int channel, int32_t * value, int * standard);
+int  caliper_read_all(int32_t * values, int * standards);
+int  caliper_latest(int channel, caliper_latest_t * latest, uint32_t * seen);
+int  caliper_channel_count(void);
 
 #endif  /* __CALIPER_H */
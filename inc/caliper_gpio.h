@@ -12,6 +12,19 @@
 /*  Pins related to caliper                                                  */
 /*---------------------------------------------------------------------------*/
 
+#define CALIPER_NODE    DT_PARENT(DT_ALIAS(caliper_clock))
+
+/*---------------------------------------------------------------------------*/
+/*  One acquisition channel per "caliper" node, in devicetree order.         */
+/*  Channel 0 is the node the caliper-* aliases point into.                  */
+/*---------------------------------------------------------------------------*/
+
+#define CALIPER_CHANNELS            DT_NUM_INST_STATUS_OKAY(caliper)
+
+#define CHANNEL_CLOCK_NODE(node)    DT_CHILD(node, clock)
+#define CHANNEL_DATA_NODE(node)     DT_CHILD(node, data)
+#define CHANNEL_REQ_NODE(node)      DT_CHILD(node, req)
+
 #define CLOCK_NODE      DT_ALIAS(caliper_clock)
 #define CLOCK           DT_GPIO_PIN(DT_ALIAS(caliper_clock), gpios)
 #define CLOCK_PORT      DT_LABEL(DT_PHANDLE_BY_IDX(DT_ALIAS(caliper_clock), gpios, 0))
@@ -30,4 +43,22 @@
 #define BUZZER_FLAGS    DT_PHA_BY_IDX(DT_ALIAS(caliper_buzzer), gpios, 0, flags)
 #define BUZZER_LABEL    DT_PROP(DT_ALIAS(caliper_buzzer), label)
 
+/*---------------------------------------------------------------------------*/
+/*  SPIS capture: CSN is driven by firmware on the SELECT pin                */
+/*---------------------------------------------------------------------------*/
+
+#define SPIS_NODE       DT_ALIAS(caliper_spis)
+
+#define SELECT_NODE     DT_ALIAS(caliper_select)
+#define SELECT          DT_GPIO_PIN(DT_ALIAS(caliper_select), gpios)
+#define SELECT_LABEL    DT_PROP(DT_ALIAS(caliper_select), label)
+
+/*---------------------------------------------------------------------------*/
+/*  Digimatic capture: REQ output to the gauge                               */
+/*---------------------------------------------------------------------------*/
+
+#define REQ_NODE        DT_ALIAS(caliper_req)
+#define REQ             DT_GPIO_PIN(DT_ALIAS(caliper_req), gpios)
+#define REQ_LABEL       DT_PROP(DT_ALIAS(caliper_req), label)
+
 #endif  /* __CALIPER_GPIO_H */
\ No newline at end of file
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   datum.h
+ */
+#ifndef __DATUM_H
+#define __DATUM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "readings.h"
+#include "caliper_gpio.h"
+
+/*---------------------------------------------------------------------------*/
+/*  One datum slot: a zero per channel, in reading counts (see caliper.h)    */
+/*---------------------------------------------------------------------------*/
+
+#define DATUM_NONE        (-1)    // absolute readings
+#define DATUM_NAME_SIZE   9
+
+typedef struct {
+    bool      defined;
+    char      name [DATUM_NAME_SIZE];
+    int32_t   zero [CALIPER_CHANNELS];
+    uint8_t   standard [CALIPER_CHANNELS];
+} datum_slot_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void datum_init(void);
+void datum_apply(caliper_reading_t * reading);
+void datum_relative(caliper_reading_t * reading);
+int  datum_capture(int slot, const char * name);
+int  datum_clear(int slot);
+int  datum_select(int slot);
+int  datum_active(void);
+int  datum_find(const char * name);
+int  datum_get(int slot, datum_slot_t * datum);
+int  datum_absolute(int channel, int32_t * value, int * standard);
+
+#endif  /* __DATUM_H */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   decoder.h
+ */
+#ifndef __DECODER_H
+#define __DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*---------------------------------------------------------------------------*/
+/*  One raw frame, as handed over by a capture engine                        */
+/*---------------------------------------------------------------------------*/
+
+#define DECODER_MAX_BITS       64
+
+typedef struct {
+    uint64_t  data;       // data bits, bit 0 first on the wire
+    uint8_t   bits;       // falling clock edges counted in frame
+    int8_t    units;      // DATA level sampled after last edge, -1 if none
+    uint32_t  duration;   // usecs, first to last clock edge, 0 if unknown
+} caliper_frame_t;
+
+/*---------------------------------------------------------------------------*/
+/*  Protocol descriptor                                                      */
+/*---------------------------------------------------------------------------*/
+
+#define DECODER_UNITS_AFTER_FRAME   0xFF   /* units flag sampled after frame */
+
+struct caliper_decoder;
+
+typedef int (*decoder_fn_t)(const struct caliper_decoder * decoder,
+                            const caliper_frame_t * frame,
+                            int32_t * value, int * standard);
+
+typedef struct caliper_decoder {
+    const char *  name;
+    decoder_fn_t  decode;
+    uint8_t       bits;         // clock edges per frame
+    uint16_t      bit_min_us;   // bit period window, for auto-detection
+    uint16_t      bit_max_us;
+    bool          detect;       // candidate for auto-detection
+    uint64_t      sample;       // known-good frame, for the benchmark
+
+    /* Layout, for the table-driven binary decoders */
+    uint8_t       value_bits;
+    uint8_t       sign_bit;
+    uint8_t       units_bit;    // or DECODER_UNITS_AFTER_FRAME
+    uint8_t       drop_bits;    // low bits that are not part of the count
+    uint8_t       mm_scale;     // reading counts per count (mm)
+    uint8_t       inch_scale;   // reading counts per count (inch)
+
+    /* Bits with a constant value, checked when validating */
+    uint64_t      reserved_mask;
+    uint64_t      reserved_value;
+} caliper_decoder_t;
+
+typedef struct {
+    uint32_t  decodes;
+    uint32_t  errors;
+    uint32_t  last_ns;    // zero unless CONFIG_CALIPER_DECODER_BENCHMARK
+    uint32_t  max_ns;
+} decoder_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void         decoder_init(void);
+int          decoder_decode(int channel, const caliper_frame_t * frame,
+                            int32_t * value, int * standard);
+int          decoder_frame_bits(int channel);
+uint32_t     decoder_bit_period_us(int channel);
+uint32_t     decoder_units_delay_us(int channel);
+int          decoder_select(int channel, const char * name);
+const char * decoder_name(int channel);
+int          decoder_count(void);
+const caliper_decoder_t * decoder_get(int index, decoder_stats_t * stats);
+int          decoder_benchmark(int index, int rounds, uint32_t * ns);
+
+#endif  /* __DECODER_H */
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   edge_capture.h
+ */
+#ifndef __EDGE_CAPTURE_H
+#define __EDGE_CAPTURE_H
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/*---------------------------------------------------------------------------*/
+/*  One frame as seen by the edge engine; times are TIMER usecs.             */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint64_t  frame;      // data bits, bit 0 first on the wire
+    uint8_t   bits;       // falling clock edges counted in frame
+    uint8_t   units;      // DATA level sampled after last edge
+    uint32_t  start;      // first falling edge
+    uint32_t  end;        // last falling edge
+} edge_frame_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void     edge_capture_init(void);
+int      edge_capture_wait_gap(int channel, k_timeout_t timeout);
+int      edge_capture_get_frame(int channel, edge_frame_t * frame,
+                                k_timeout_t timeout);
+void     edge_capture_set_frame_bits(int channel, int bits);
+void     edge_capture_set_gap_us(int channel, uint32_t gap_us);
+void     edge_capture_flush(int channel);
+int      edge_capture_get_edges(int channel, uint32_t * edges, int count);
+
+#endif  /* __EDGE_CAPTURE_H */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   filter.h
+ */
+#ifndef __FILTER_H
+#define __FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef enum {
+    FILTER_OFF     = 0,
+    FILTER_MEDIAN  = 1,    // median of the last CONFIG_CALIPER_FILTER_N
+    FILTER_IIR     = 2,    // first order low-pass
+    FILTER_KALMAN  = 3,    // constant-position 1-D Kalman
+} filter_mode_t;
+
+typedef struct {
+    uint32_t  frames;
+    uint32_t  resets;     // movement or a change of standard
+    uint32_t  last_ns;    // zero unless CONFIG_CALIPER_DECODER_BENCHMARK
+    uint32_t  max_ns;
+} filter_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void          filter_reading(caliper_reading_t * reading);
+void          filter_set_mode(filter_mode_t mode);
+filter_mode_t filter_get_mode(void);
+const char *  filter_mode_name(filter_mode_t mode);
+void          filter_set_average(bool enable);
+bool          filter_average_enabled(void);
+int           filter_average(int channel, int32_t * value, int * standard);
+void          filter_get_stats(int channel, filter_stats_t * stats);
+
+#endif  /* __FILTER_H */
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   fixed.h
+ */
+#ifndef __FIXED_H
+#define __FIXED_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int64_t  fixed_div_round(int64_t numerator, int64_t denominator);
+uint32_t fixed_sqrt(uint64_t value);
+
+#endif  /* __FIXED_H */
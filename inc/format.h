@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   format.h
+ */
+#ifndef __FORMAT_H
+#define __FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+/* Use CALIPER_OUTPUT_MM_DECIMALS / CALIPER_OUTPUT_INCH_DECIMALS. */
+#define FORMAT_DECIMALS_DEFAULT   (-1)
+
+/* Every decimal the reading holds. */
+#define FORMAT_DECIMALS_ALL       9
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int format_value(char * buffer, size_t size, int32_t value, int standard,
+                 int decimals);
+int format_parse(const char * text, int standard, int32_t * value);
+
+#endif  /* __FORMAT_H */
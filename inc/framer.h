@@ -4,6 +4,9 @@
 #ifndef __FRAMER_H
 #define __FRAMER_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -17,6 +20,9 @@
 void framer_init(void);
 void framer_find_interframe_gap(void);
 bool is_caliper_on(void);
+uint32_t framer_frame_period_us(int channel);
+uint32_t framer_frame_us(int channel);
+uint32_t framer_gap_us(int channel);
 
 /*---------------------------------------------------------------------------*/
 /* Used with logic analyzer for debugging purposes.                          */
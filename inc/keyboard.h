@@ -11,9 +11,27 @@
 #include "ascii2hid.h"
 #include <zephyr/usb/class/hid.h>  /* USB and BLE HID defs are same */
 
+/*---------------------------------------------------------------------------*/
+/*  One keystroke: HID modifier bits and key code                            */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint8_t  modifier;
+    uint8_t  code;
+} keyboard_key_t;
+
+/* No room in the keyboard queue for this long: the link has gone. */
+#define KEYBOARD_QUEUE_STALL   K_MSEC(1000)
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 void keyboard_send_string(char * value);
+void keyboard_send_keys(const keyboard_key_t * keys, int count, bool quiet);
+int  keyboard_ascii_key(uint8_t ascii, keyboard_key_t * key);
+int  keyboard_queue_keys(const keyboard_key_t * keys, int count,
+                         k_timeout_t timeout);
+int  keyboard_queue_drain(k_timeout_t timeout);
+void keyboard_queue_flush(void);
 
 #endif /* KEYBOARD_H */
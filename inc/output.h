@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   output.h
+ */
+#ifndef __OUTPUT_H
+#define __OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keyboard.h"
+
+/*---------------------------------------------------------------------------*/
+/*  One reading to be typed, with what the template may refer to             */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    int32_t   value;
+    int       standard;
+    int       channel;
+    uint32_t  seq;         // caliper_latest() sequence, 0 if unknown
+    int64_t   timestamp;   // k_uptime_ticks(), 0 if unknown
+    bool      last;        // last channel of the snapshot
+} output_reading_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void         output_init(void);
+int          output_compile(const char * template);
+const char * output_template(void);
+int          output_render(const output_reading_t * reading,
+                           keyboard_key_t * keys, int size);
+int          output_cells(const char * const * cells, int count,
+                          keyboard_key_t * keys, int size);
+
+#endif  /* __OUTPUT_H */
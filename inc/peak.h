@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   peak.h
+ */
+#ifndef __PEAK_H
+#define __PEAK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Extremes held from arm to disarm, in reading counts (see caliper.h)      */
+/*---------------------------------------------------------------------------*/
+
+typedef enum {
+    PEAK_MAX = 0,       // peak
+    PEAK_MIN = 1,       // valley
+    PEAK_TIR = 2,       // total indicated runout: max - min
+} peak_mode_t;
+
+/* One value per channel, CALIPER_CHANNELS of each. */
+typedef void (*peak_notify_t)(const int32_t * values, const int * standards);
+
+typedef struct {
+    uint32_t  frames;      // readings held
+    uint32_t  dropped;     // frames that went by without being held
+    int32_t   min;
+    int32_t   max;
+    uint8_t   standard;
+} peak_hold_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void         peak_reading(const caliper_reading_t * reading);
+int          peak_arm(void);
+int          peak_disarm(void);
+bool         peak_armed(void);
+int          peak_get(int channel, peak_hold_t * hold);
+void         peak_set_mode(peak_mode_t mode);
+peak_mode_t  peak_get_mode(void);
+const char * peak_mode_name(peak_mode_t mode);
+void         peak_register_notify_handler(peak_notify_t notify);
+
+#endif  /* __PEAK_H */
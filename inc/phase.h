@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   phase.h
+ */
+#ifndef __PHASE_H
+#define __PHASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    bool      locked;
+    uint32_t  period;      // usecs, drift corrected
+    uint32_t  jitter;      // usecs, mean prediction error
+    uint32_t  duration;    // usecs, first to last clock edge
+    uint32_t  locks;       // times lock was (re)acquired
+    uint32_t  misses;      // predictions that were wrong
+} phase_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int64_t phase_now_us(void);
+void    phase_frame_end(int64_t end);
+bool    phase_frame(int64_t start, int64_t end);
+int     phase_predict(int64_t * arm);
+bool    phase_is_locked(void);
+void    phase_unlock(void);
+void    phase_get_stats(phase_stats_t * stats);
+
+#endif  /* __PHASE_H */
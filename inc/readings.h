@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   readings.h
+ */
+#ifndef __READINGS_H
+#define __READINGS_H
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/*---------------------------------------------------------------------------*/
+/*  One decoded caliper frame                                                */
+/*---------------------------------------------------------------------------*/
+
+#define READING_FLAG_VALID     BIT(0)   // decoded and passed validation
+#define READING_FLAG_REJECTED  BIT(1)   // implausible jump from the last one
+#define READING_FLAG_PENDING   BIT(2)   // waiting for the N-of-M vote
+#define READING_FLAG_VOTED     BIT(3)   // confirmed by the N-of-M vote
+
+typedef struct {
+    int64_t   timestamp;   // k_uptime_ticks() when decoded
+    int32_t   value;       // as returned by caliper_read_value()
+    uint8_t   standard;    // CALIPER_STANDARD_xxx
+    uint8_t   flags;       // READING_FLAG_xxx
+    uint8_t   channel;     // caliper channel index
+} caliper_reading_t;
+
+typedef struct {
+    uint32_t  frames;         // records put
+    uint32_t  dropped;        // frames that went by undecoded (continuous)
+    uint32_t  frame_period;   // usecs, smoothed; 0 = unknown
+} readings_stats_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void     readings_put(const caliper_reading_t * reading);
+int      readings_latest(int channel, caliper_reading_t * reading);
+int      readings_history(caliper_reading_t * readings, int count);
+uint32_t readings_frame_period_us(int channel);
+void     readings_get_stats(int channel, readings_stats_t * stats);
+
+#endif  /* __READINGS_H */
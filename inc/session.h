@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   session.h
+ */
+#ifndef __SESSION_H
+#define __SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*---------------------------------------------------------------------------*/
+/*  One stored reading, in reading counts (see caliper.h), and its cell      */
+/*---------------------------------------------------------------------------*/
+
+#define SESSION_COLUMNS_MAX   16
+
+typedef struct {
+    int32_t   value;
+    uint16_t  row;
+    uint8_t   column;
+    uint8_t   standard;
+} session_cell_t;
+
+typedef struct {
+    uint32_t  keys;        // keystrokes typed
+    uint32_t  ms;          // from the first queued to the last typed
+} session_report_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void session_init(void);
+void session_enable(bool enable);
+bool session_enabled(void);
+int  session_put(const int32_t * values, const int * standards, int number);
+int  session_set_columns(int number);
+void session_next_row(void);
+int  session_columns(void);
+int  session_count(void);
+int  session_get(int n, session_cell_t * cell);
+void session_clear(void);
+int  session_type(session_report_t * report);
+
+#endif  /* __SESSION_H */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   sigmon.h
+ */
+#ifndef __SIGMON_H
+#define __SIGMON_H
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "decoder.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Histograms are log2 bins of usecs: bin n counts [2^n, 2^(n+1)) usecs,    */
+/*  bin 0 also counts 0, the last bin everything longer.                     */
+/*---------------------------------------------------------------------------*/
+
+#define SIGMON_BINS     16
+
+typedef enum {
+    SIGMON_LOW = 0,       // CLOCK low, falling to rising edge
+    SIGMON_HIGH,          // CLOCK high, rising to falling edge
+    SIGMON_PERIOD,        // falling to falling edge, within a frame
+    SIGMON_GAP,           // last edge of a frame to first of the next
+    SIGMON_HISTOGRAMS
+} sigmon_histogram_t;
+
+typedef struct {
+    uint32_t  bins [SIGMON_HISTOGRAMS][SIGMON_BINS];
+    uint32_t  glitches;       // pulses below CALIPER_SIGNAL_GLITCH_US
+    uint32_t  short_pulses;   // pulses far below the measured bit period
+    uint32_t  frames;         // frames captured
+    uint32_t  bad_frames;     // frames that did not decode
+} sigmon_stats_t;
+
+typedef struct {
+    int64_t          timestamp;   // k_uptime_ticks() when captured
+    caliper_frame_t  frame;
+    int8_t           status;      // decode result, 0 or -errno
+    uint8_t          channel;
+} sigmon_frame_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sigmon_width(int channel, sigmon_histogram_t histogram, uint32_t us);
+void sigmon_frame(int channel, const caliper_frame_t * frame, int status);
+void sigmon_get_stats(int channel, sigmon_stats_t * stats);
+int  sigmon_frames(sigmon_frame_t * frames, int count);
+void sigmon_reset(void);
+
+#endif  /* __SIGMON_H */
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   spis_capture.h
+ */
+#ifndef __SPIS_CAPTURE_H
+#define __SPIS_CAPTURE_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/*  First CLOCK edge of an armed frame; interrupt level.                     */
+/*---------------------------------------------------------------------------*/
+typedef void (*spis_capture_start_t)(void);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void spis_capture_init(spis_capture_start_t start);
+int  spis_capture_arm(void);
+void spis_capture_disarm(void);
+int  spis_capture_frame(uint32_t units_us, uint64_t * frame, int * bits,
+                        int * units, uint32_t * duration);
+
+#endif  /* __SPIS_CAPTURE_H */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   stats.h
+ */
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keyboard.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Summary of one channel, in reading counts (see caliper.h)                */
+/*---------------------------------------------------------------------------*/
+
+typedef enum {
+    STATS_WINDOW  = 0,    // last CONFIG_CALIPER_STATS_WINDOW readings
+    STATS_SESSION = 1,    // everything since the last reset
+} stats_scope_t;
+
+typedef struct {
+    uint32_t  count;
+    int32_t   min;
+    int32_t   max;
+    int32_t   mean;       // rounded to the nearest count
+    int32_t   stddev;     // sample standard deviation (n - 1), rounded
+    uint8_t   standard;
+} stats_summary_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void stats_reading(int channel, int32_t value, int standard);
+int  stats_get(int channel, stats_scope_t scope, stats_summary_t * summary);
+void stats_reset(void);
+void stats_set_summary_only(bool enable);
+bool stats_summary_only(void);
+int  stats_render(stats_scope_t scope, keyboard_key_t * keys, int size);
+
+#endif  /* __STATS_H */
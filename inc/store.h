@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   store.h
+ */
+#ifndef __STORE_H
+#define __STORE_H
+
+#include <stddef.h>
+#include <zephyr/settings/settings.h>
+
+/*---------------------------------------------------------------------------*/
+/*  A settings subtree holding one int ("<subtree>/<scalar>") and a table    */
+/*  of same-sized items ("<subtree>/<n>").                                   */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char * subtree;
+    const char * scalar;       // "active", "count"
+    int *        value;
+    void *       items;
+    size_t       item_size;
+    int          item_count;
+} store_table_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int store_table_set(const store_table_t * table, const char * name,
+                    size_t len, settings_read_cb read_cb, void * cb_arg);
+int store_table_load(const store_table_t * table);
+
+#endif  /* __STORE_H */
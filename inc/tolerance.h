@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   tolerance.h
+ */
+#ifndef __TOLERANCE_H
+#define __TOLERANCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keyboard.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Limits of one feature, in reading counts (see caliper.h)                 */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    bool      defined;
+    uint8_t   standard;
+    int32_t   nominal;
+    int32_t   lower;      // deviation from nominal, usually negative
+    int32_t   upper;      // deviation from nominal
+} tolerance_limits_t;
+
+typedef enum {
+    TOLERANCE_NONE = 0,   // no limits for the active feature
+    TOLERANCE_PASS,
+    TOLERANCE_LOW,
+    TOLERANCE_HIGH,
+} tolerance_class_t;
+
+#define TOLERANCE_BINS   (CONFIG_CALIPER_TOLERANCE_BINS + 2)  // + under, over
+
+typedef struct {
+    uint32_t  count;
+    uint32_t  low;
+    uint32_t  high;
+    int32_t   mean;       // counts, as a deviation from nominal
+    int32_t   stddev;     // counts
+    int32_t   cp;         // thousandths; 0 if undefined
+    int32_t   cpk;        // thousandths
+    uint32_t  bins [TOLERANCE_BINS];   // [0] below lower ... [last] above
+} tolerance_spc_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void              tolerance_init(void);
+int               tolerance_set(int feature, const tolerance_limits_t * limits);
+int               tolerance_get(int feature, tolerance_limits_t * limits);
+int               tolerance_select(int feature);
+int               tolerance_active(void);
+tolerance_class_t tolerance_classify(int32_t value, int standard);
+tolerance_class_t tolerance_capture(int32_t value, int standard);
+int               tolerance_get_spc(tolerance_spc_t * spc);
+void              tolerance_reset(void);
+int               tolerance_render(keyboard_key_t * keys, int size);
+
+#endif  /* __TOLERANCE_H */
@@ -19,5 +19,8 @@ extern buzzer_play_t send_completed_sound;
 extern buzzer_play_t caliper_off_sound;
 extern buzzer_play_t ble_not_connected_sound;
 extern buzzer_play_t error_sound;
+extern buzzer_play_t tolerance_pass_sound;
+extern buzzer_play_t tolerance_low_sound;
+extern buzzer_play_t tolerance_high_sound;
 
 #endif /* __TONES_H__ */
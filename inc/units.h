@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   units.h
+ */
+#ifndef __UNITS_H
+#define __UNITS_H
+
+#include <stdint.h>
+
+#include "app_uicr.h"
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void    units_init(void);
+units_t units_get_policy(void);
+void    units_set_policy(units_t units);
+int32_t units_convert(int32_t value, int from_standard, int to_standard);
+void    units_apply(caliper_reading_t * reading);
+
+#endif  /* __UNITS_H */
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *   validate.h
+ */
+#ifndef __VALIDATE_H
+#define __VALIDATE_H
+
+#include "readings.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int  validate_reading(caliper_reading_t * reading);
+void validate_reset(int channel);
+
+#endif  /* __VALIDATE_H */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  activity.c  -- Caliper power detection by counting CLOCK edges.
+ *
+ *  A powered caliper clocks out a frame several times per second; one
+ *  that is off leaves CLOCK idle.  So CLOCK edges are counted in
+ *  hardware (GPIOTE event -> PPI -> TIMER4 COUNT task) and the counter is
+ *  sampled from a kernel timer.  The CPU never sees an edge.
+ *
+ *  Hysteresis: ON after one sample period with at least
+ *  CALIPER_ACTIVITY_ON_EDGES edges (about a frame), OFF only after
+ *  CALIPER_ACTIVITY_OFF_MS without any edge.  Transitions are passed
+ *  to the registered handler from the system workqueue.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_gpio.h>
+
+#include "activity.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(activity, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define ACTIVITY_TIMER_NODE   DT_NODELABEL(timer4)
+#define ACTIVITY_GPIOTE_NODE  DT_NODELABEL(gpiote)
+
+#define ACTIVITY_OFF_PERIODS  DIV_ROUND_UP(CONFIG_CALIPER_ACTIVITY_OFF_MS, \
+                                           CONFIG_CALIPER_ACTIVITY_PERIOD_MS)
+
+/* Edge rate is measured over about a second: several slow-mode frames. */
+#define ACTIVITY_RATE_PERIODS DIV_ROUND_UP(1000, CONFIG_CALIPER_ACTIVITY_PERIOD_MS)
+#define ACTIVITY_RATE_MS      (ACTIVITY_RATE_PERIODS * \
+                               CONFIG_CALIPER_ACTIVITY_PERIOD_MS)
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(0);
+static const nrfx_timer_t  timer  = NRFX_TIMER_INSTANCE(4);
+
+static const uint32_t clock_psel = NRF_DT_GPIOS_TO_PSEL(CLOCK_NODE, gpios);
+
+static void activitySample(struct k_timer * timer_id);
+static void activityNotify(struct k_work * work);
+
+K_TIMER_DEFINE(activity_timer, activitySample, NULL);
+K_WORK_DEFINE(activity_work, activityNotify);
+
+static activity_notify_t notify_handler = NULL;
+
+static struct {
+    bool      on;
+    uint32_t  count;        // counter at last sample
+    uint32_t  last_edges;
+    uint32_t  edges;
+    uint32_t  quiet;        // sample periods without an edge
+    uint32_t  transitions;
+    uint32_t  window;       // edges so far in the rate window
+    uint32_t  samples;      // sample periods so far in the rate window
+    uint32_t  edge_rate;    // edges per second, last window
+} activity;
+
+/*---------------------------------------------------------------------------*/
+/*  Counter mode: nothing to handle, but nrfx wants a handler.               */
+/*---------------------------------------------------------------------------*/
+static void activityTimerHandler(nrf_timer_event_t event, void * context)
+{
+    ARG_UNUSED(event);
+    ARG_UNUSED(context);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Kernel timer, every CALIPER_ACTIVITY_PERIOD_MS.                          */
+/*---------------------------------------------------------------------------*/
+static void activitySample(struct k_timer * timer_id)
+{
+    uint32_t count = nrfx_timer_capture(&timer, NRF_TIMER_CC_CHANNEL0);
+    uint32_t delta = count - activity.count;
+    bool     on    = activity.on;
+
+    activity.count      = count;
+    activity.last_edges = delta;
+    activity.edges     += delta;
+
+    activity.window += delta;
+    if (++activity.samples >= ACTIVITY_RATE_PERIODS) {
+        activity.edge_rate = (activity.window * 1000) / ACTIVITY_RATE_MS;
+        activity.window    = 0;
+        activity.samples   = 0;
+    }
+
+    if (delta == 0) {
+        if (activity.quiet < ACTIVITY_OFF_PERIODS) {
+            activity.quiet++;
+        }
+        if (activity.quiet >= ACTIVITY_OFF_PERIODS) {
+            on = false;
+        }
+    }
+    else {
+        activity.quiet = 0;
+        if (delta >= CONFIG_CALIPER_ACTIVITY_ON_EDGES) {
+            on = true;
+        }
+    }
+
+    if (on != activity.on) {
+        activity.on = on;
+        activity.transitions++;
+        k_work_submit(&activity_work);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void activityNotify(struct k_work * work)
+{
+    bool on = activity.on;
+
+    LOG_INF("Caliper is \"%s\"", (on) ? "ON" : "OFF");
+
+    if (notify_handler) {
+        notify_handler(on);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool activity_is_on(void)
+{
+    return activity.on;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void activity_register_notify_handler(activity_notify_t notify)
+{
+    notify_handler = notify;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void activity_get_stats(activity_stats_t * stats)
+{
+    stats->on          = activity.on;
+    stats->edges       = activity.edges;
+    stats->last_edges  = activity.last_edges;
+    stats->transitions = activity.transitions;
+    stats->edge_rate   = activity.edge_rate;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The GPIO driver switches the CLOCK GPIOTE channel off with its pin       */
+/*  interrupt (GPIO_INT_DISABLE); turn the event, not the interrupt, back    */
+/*  on so edges keep being counted.  Called after each such disable.         */
+/*---------------------------------------------------------------------------*/
+void activity_resume(void)
+{
+#if !defined(CONFIG_CALIPER_CAPTURE_EDGE)
+    nrfx_gpiote_trigger_enable(&gpiote, clock_psel, false);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/*  CLOCK edge event: the edge engine already has one, else make one.        */
+/*---------------------------------------------------------------------------*/
+static int activityEventInit(void)
+{
+#if !defined(CONFIG_CALIPER_CAPTURE_EDGE)
+    nrfx_err_t err;
+    uint8_t    in_channel;
+
+    static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_PULLDOWN;
+
+    err = nrfx_gpiote_channel_alloc(&gpiote, &in_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no GPIOTE channel", err);
+        return -ENODEV;
+    }
+
+    nrfx_gpiote_trigger_config_t trigger_config = {
+        .trigger      = NRFX_GPIOTE_TRIGGER_HITOLO,
+        .p_in_channel = &in_channel,
+    };
+    nrfx_gpiote_input_pin_config_t input_config = {
+        .p_pull_config    = &pull,
+        .p_trigger_config = &trigger_config,
+        .p_handler_config = NULL,
+    };
+
+    err = nrfx_gpiote_input_configure(&gpiote, clock_psel, &input_config);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: failed to configure clock", err);
+        return -EIO;
+    }
+
+    nrfx_gpiote_trigger_enable(&gpiote, clock_psel, false);
+#endif
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  After caliper_init(): the CLOCK pin (and edge engine) must be set up.    */
+/*---------------------------------------------------------------------------*/
+void activity_init(void)
+{
+    nrfx_err_t err;
+    uint8_t    ppi_channel;
+
+    LOG_INF("%s", __func__);
+
+    /*
+     *  TIMER4 as a 32-bit counter of CLOCK edges.
+     */
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_cfg.mode      = NRF_TIMER_MODE_LOW_POWER_COUNTER;
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+    IRQ_CONNECT(DT_IRQN(ACTIVITY_TIMER_NODE), DT_IRQ(ACTIVITY_GPIOTE_NODE, priority),
+                nrfx_isr, nrfx_timer_4_irq_handler, 0);
+
+    err = nrfx_timer_init(&timer, &timer_cfg, activityTimerHandler);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: timer init failed", err);
+        return;
+    }
+
+    if (activityEventInit() != 0) {
+        return;
+    }
+
+    /*
+     *  PPI: CLOCK edge event -> TIMER4 COUNT task.
+     */
+    err = nrfx_gppi_channel_alloc(&ppi_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no PPI channel", err);
+        return;
+    }
+
+    nrfx_gppi_channel_endpoints_setup(ppi_channel,
+        nrfx_gpiote_in_event_address_get(&gpiote, clock_psel),
+        nrfx_timer_task_address_get(&timer, NRF_TIMER_TASK_COUNT));
+
+    nrfx_gppi_channels_enable(BIT(ppi_channel));
+
+    nrfx_timer_enable(&timer);
+
+    k_timer_start(&activity_timer, K_MSEC(CONFIG_CALIPER_ACTIVITY_PERIOD_MS),
+                  K_MSEC(CONFIG_CALIPER_ACTIVITY_PERIOD_MS));
+}
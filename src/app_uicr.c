@@ -30,9 +30,19 @@ LOG_MODULE_REGISTER(uicr, LOG_LEVEL_INF);
 
 #define __LINE_END__    0
 #define __STANDARD__    1
+#define __UNITS__       2
 
 #define REG_LINE_END  CUSTOMER[__LINE_END__] 
 #define REG_STANDARD  CUSTOMER[__STANDARD__] 
+#define REG_UNITS     CUSTOMER[__UNITS__]
+
+#if defined(CONFIG_CALIPER_UNITS_MM)
+#define CALIPER_UNITS_DEFAULT   ALWAYS_MM
+#elif defined(CONFIG_CALIPER_UNITS_INCH)
+#define CALIPER_UNITS_DEFAULT   ALWAYS_INCH
+#else
+#define CALIPER_UNITS_DEFAULT   AS_CALIPER
+#endif
 
 static const struct device * const device =
                   DEVICE_DT_GET_OR_NULL(DT_CHOSEN(zephyr_flash_controller));
@@ -152,6 +162,30 @@ void app_uicr_set_standard(standard_t standard)
     app_uicr_write_one((uint32_t)&NRF_UICR->REG_STANDARD, (uint8_t)standard);   
 }
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+units_t app_uicr_get_units(void)
+{
+    units_t units = app_uicr_read_one((uint32_t)&NRF_UICR->REG_UNITS);
+
+    LOG_DBG("%s: Get UNITS: addr: [0x%x], value: 0x%x", __func__,
+            (uint32_t)&NRF_UICR->REG_UNITS, (uint8_t)units);
+
+    return units;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void app_uicr_set_units(units_t units)
+{
+    LOG_DBG("%s: Set UNITS: addr: [0x%x], value: 0x%x", __func__,
+            (uint32_t)&NRF_UICR->REG_UNITS, units);
+
+    app_uicr_write_one((uint32_t)&NRF_UICR->REG_UNITS, (uint8_t)units);
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -161,6 +195,7 @@ void app_uicr_init(void)
 
     line_end_t line_end;
     standard_t standard;
+    units_t    units;
 
     if (device) {
         LOG_INF("%s: Flash '%s'", __func__, device->name);
@@ -183,6 +218,15 @@ void app_uicr_init(void)
         standard = app_uicr_get_standard();
     }
 
+    units = app_uicr_get_units();
+
+    if (units == __UNINITIALIZED__ || units == INVALID_UNITS ||
+        units > ALWAYS_INCH) {
+        app_uicr_set_units(CALIPER_UNITS_DEFAULT);    // set default
+        units = app_uicr_get_units();
+    }
+
     LOG_INF("[LINE_END] 0x%x", line_end);
     LOG_INF("[STANDARD] 0x%x", standard);
+    LOG_INF("[UNITS]    0x%x", units);
 }
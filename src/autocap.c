@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  autocap.c  -- Auto-capture on settle
+ *
+ *  A channel has settled once its published readings have stayed within
+ *  the deadband of each other for the dwell time; when the jaws have
+ *  moved since the last capture and every channel has settled, the
+ *  settled values are handed to the notify handler, once.  Movement
+ *  beyond the deadband re-arms.  Nothing is captured until the jaws first
+ *  move, so a caliper at rest when powered on types nothing.
+ */
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+
+#include "autocap.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(autocap, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static void autocapNotify(struct k_work * work);
+
+K_WORK_DEFINE(autocap_work, autocapNotify);
+
+static autocap_notify_t notify_handler = NULL;
+
+typedef struct {
+    bool      have;
+    int32_t   value;        // start of the current still period
+    uint8_t   standard;
+    int64_t   since;        // k_uptime_ticks()
+} autocap_channel_t;
+
+static autocap_channel_t channels [CALIPER_CHANNELS];
+
+static struct {
+    bool      enabled;
+    bool      armed;
+    uint32_t  captures;
+    int32_t   values [CALIPER_CHANNELS];     // handed to the notify handler
+    int       standards [CALIPER_CHANNELS];
+} autocap = {
+    .enabled = true,
+};
+
+/*---------------------------------------------------------------------------*/
+/*  Every channel still for at least the dwell time, as of now.              */
+/*---------------------------------------------------------------------------*/
+static bool autocapSettled(int64_t now)
+{
+    int64_t dwell = k_ms_to_ticks_ceil64(CONFIG_CALIPER_AUTO_CAPTURE_DWELL_MS);
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        if (!channels[i].have || now - channels[i].since < dwell) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Caliper thread, after each good reading.                                 */
+/*---------------------------------------------------------------------------*/
+void autocap_reading(const caliper_reading_t * reading)
+{
+    autocap_channel_t * ch = &channels[reading->channel];
+
+    if (!autocap.enabled) {
+        return;
+    }
+
+    if (!ch->have || reading->standard != ch->standard ||
+        abs(reading->value - ch->value) >
+            CALIPER_UM_TO_COUNTS(CONFIG_CALIPER_AUTO_CAPTURE_DEADBAND,
+                                 reading->standard)) {
+
+        /*
+         *  Moving: restart the still period here.  The first reading
+         *  only sets the reference, it is not movement.
+         */
+        if (ch->have) {
+            autocap.armed = true;
+        }
+        ch->have     = true;
+        ch->value    = reading->value;
+        ch->standard = reading->standard;
+        ch->since    = reading->timestamp;
+        return;
+    }
+
+    if (!autocap.armed || !autocapSettled(reading->timestamp)) {
+        return;
+    }
+
+    /*
+     *  Settled: capture the newest reading of each channel.  A capture
+     *  still being typed is not overwritten.
+     */
+    if (k_work_is_pending(&autocap_work)) {
+        return;
+    }
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        caliper_latest_t latest;
+
+        if (caliper_latest(i, &latest, NULL) != 0) {
+            return;
+        }
+        autocap.values[i]    = latest.value;
+        autocap.standards[i] = latest.standard;
+    }
+
+    autocap.armed = false;
+    autocap.captures++;
+
+    k_work_submit(&autocap_work);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void autocapNotify(struct k_work * work)
+{
+    LOG_INF("%s: settled", __func__);
+
+    if (notify_handler) {
+        notify_handler(autocap.values, autocap.standards);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Disabling forgets the still periods; capture resumes after movement.     */
+/*---------------------------------------------------------------------------*/
+void autocap_enable(bool enable)
+{
+    if (!enable) {
+        for (int i=0; i < CALIPER_CHANNELS; i++) {
+            channels[i].have = false;
+        }
+        autocap.armed = false;
+    }
+    autocap.enabled = enable;
+
+    LOG_INF("%s: %s", __func__, (enable) ? "on" : "off");
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void autocap_register_notify_handler(autocap_notify_t notify)
+{
+    notify_handler = notify;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void autocap_get_stats(autocap_stats_t * stats)
+{
+    stats->enabled  = autocap.enabled;
+    stats->armed    = autocap.armed;
+    stats->captures = autocap.captures;
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  burst.c  -- Burst capture while SNAPSHOT is held
+ *
+ *  Between burst_start() and burst_stop() every published reading goes
+ *  into the batch ring with its time since the start of the burst;
+ *  nothing is typed while capturing.  burst_stop() hands the burst to the
+ *  emitter thread, which types it as one block, a row per frame:
+ *
+ *      ms TAB [channel TAB] value ENTER
+ *
+ *  through the keyboard queue, as fast as the link takes keystrokes.  The
+ *  emitter only frees a frame's slot once it is typed, so the next burst
+ *  can be captured while the last one is still going out.  Frames that
+ *  find the ring full are counted as overflows and lost.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "burst.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+#include "keyboard.h"
+#include "output.h"
+#include "format.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(burst, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define BURST_SIZE       CONFIG_CALIPER_BURST_SIZE
+
+/* Ring indices run free; the modulo must survive their wrap. */
+BUILD_ASSERT(IS_POWER_OF_TWO(BURST_SIZE),
+             "CONFIG_CALIPER_BURST_SIZE must be a power of two");
+
+/* Keystrokes for one row: ms, channel, value and separators. */
+#define BURST_ROW_KEYS   48
+
+#define STACKSIZE 1024
+#define PRIORITY 7
+
+static burst_entry_t batch [BURST_SIZE];
+
+static uint32_t head;          // next slot to capture into
+static uint32_t tail;          // next entry to type
+static uint32_t committed;     // end of the last finished burst
+static uint32_t last_start;    // first entry of the last finished burst
+static uint32_t start;         // first entry of the current burst
+static int64_t  start_ticks;
+
+static burst_stats_t stats;
+
+static struct k_spinlock burst_lock;
+
+K_SEM_DEFINE(burst_sem, 0, 1);
+
+/*---------------------------------------------------------------------------*/
+/*  Caliper thread, after each good reading: keep it if capturing.           */
+/*---------------------------------------------------------------------------*/
+void burst_reading(const caliper_reading_t * reading)
+{
+    burst_entry_t * entry;
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    if (stats.capturing) {
+        if (head - tail >= BURST_SIZE) {
+            stats.overflows++;
+        }
+        else {
+            entry = &batch[head % BURST_SIZE];
+            entry->ms       = k_ticks_to_ms_floor32(reading->timestamp -
+                                                    start_ticks);
+            entry->value    = reading->value;
+            entry->standard = reading->standard;
+            entry->channel  = reading->channel;
+            head++;
+            stats.frames++;
+        }
+    }
+
+    k_spin_unlock(&burst_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start capturing; -EALREADY if a burst is being captured.                 */
+/*---------------------------------------------------------------------------*/
+int burst_start(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    if (stats.capturing) {
+        k_spin_unlock(&burst_lock, key);
+        return -EALREADY;
+    }
+
+    stats.capturing = true;
+    stats.frames    = 0;
+    start           = head;
+    start_ticks     = k_uptime_ticks();
+
+    k_spin_unlock(&burst_lock, key);
+
+    LOG_INF("%s", __func__);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Stop capturing and type the burst.  -EALREADY if none was started.       */
+/*---------------------------------------------------------------------------*/
+int burst_stop(void)
+{
+    uint32_t frames;
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    if (!stats.capturing) {
+        k_spin_unlock(&burst_lock, key);
+        return -EALREADY;
+    }
+
+    stats.capturing = false;
+    stats.bursts++;
+    committed  = head;
+    last_start = start;
+    frames     = stats.frames;
+
+    k_spin_unlock(&burst_lock, key);
+
+    LOG_INF("%s: %u frames, %u overflows", __func__, frames, stats.overflows);
+
+    k_sem_give(&burst_sem);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Entry n of the last finished burst; -ENOENT past its end, or once the    */
+/*  slot has been reused.                                                    */
+/*---------------------------------------------------------------------------*/
+int burst_entry(int n, burst_entry_t * entry)
+{
+    uint32_t index;
+    int ret = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    index = last_start + n;
+
+    if (n >= 0 && (uint32_t) n < committed - last_start &&
+        head - index <= BURST_SIZE) {
+        *entry = batch[index % BURST_SIZE];
+        ret = 0;
+    }
+
+    k_spin_unlock(&burst_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void burst_get_stats(burst_stats_t * burst_stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    *burst_stats = stats;
+    burst_stats->pending = head - tail;
+
+    k_spin_unlock(&burst_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Next committed entry to type, freeing its slot.                          */
+/*---------------------------------------------------------------------------*/
+static bool burstNext(burst_entry_t * entry)
+{
+    bool ret = false;
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    if (tail != committed) {
+        *entry = batch[tail % BURST_SIZE];
+        tail++;
+        ret = true;
+    }
+
+    k_spin_unlock(&burst_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Drop whatever is committed and not yet typed.                            */
+/*---------------------------------------------------------------------------*/
+static uint32_t burstDrop(void)
+{
+    uint32_t dropped;
+    k_spinlock_key_t key = k_spin_lock(&burst_lock);
+
+    dropped = committed - tail;
+    tail    = committed;
+
+    k_spin_unlock(&burst_lock, key);
+
+    return dropped;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Render one entry as a row of keystrokes.                                 */
+/*---------------------------------------------------------------------------*/
+static int burstRow(const burst_entry_t * entry, keyboard_key_t * keys,
+                    int size)
+{
+    char ms [12];
+    char channel [4];
+    char value [16];
+    const char * cells [3];
+    int  count = 0;
+
+    snprintf(ms, sizeof(ms), "%u", entry->ms);
+    cells[count++] = ms;
+
+    if (CALIPER_CHANNELS > 1) {
+        snprintf(channel, sizeof(channel), "%u", entry->channel);
+        cells[count++] = channel;
+    }
+
+    if (format_value(value, sizeof(value), entry->value, entry->standard,
+                     FORMAT_DECIMALS_DEFAULT) < 0) {
+        return -ENOSPC;
+    }
+    cells[count++] = value;
+
+    return output_cells(cells, count, keys, size);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Type finished bursts, a row at a time, as the keyboard queue drains.     */
+/*---------------------------------------------------------------------------*/
+static void burstEmitter(void * p1, void * p2, void * p3)
+{
+    burst_entry_t  entry;
+    keyboard_key_t keys [BURST_ROW_KEYS];
+    int count;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (1) {
+        k_sem_take(&burst_sem, K_FOREVER);
+
+        while (burstNext(&entry)) {
+
+            count = burstRow(&entry, keys, ARRAY_SIZE(keys));
+            if (count < 0) {
+                LOG_WRN("%s: row not rendered (%d)", __func__, count);
+                continue;
+            }
+
+            if (keyboard_queue_keys(keys, count,
+                                    KEYBOARD_QUEUE_STALL) < count) {
+                keyboard_queue_flush();
+                LOG_WRN("%s: keyboard stalled, %u rows dropped",
+                        __func__, burstDrop() + 1);
+                break;
+            }
+        }
+    }
+}
+
+K_THREAD_DEFINE(burst_id, STACKSIZE, burstEmitter,
+                NULL, NULL, NULL, PRIORITY, 0, 0);
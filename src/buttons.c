@@ -48,6 +48,10 @@ static const button_info_t unknown = {.id=INVALID_ID, .pin=0 , .bit= 0, .name= "
 
 #define DEBOUNCE_MS 150
 
+#if defined(CONFIG_CALIPER_BURST)
+#define HOLD_MS     MAX(CONFIG_CALIPER_BURST_HOLD_MS, DEBOUNCE_MS)
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -59,6 +63,12 @@ typedef struct {
     struct k_work      work;
     button_info_t    * current;
     buttons_notify_t   notify;
+#if defined(CONFIG_CALIPER_BURST)
+    struct k_work_delayable hold_work;
+    buttons_hold_t     hold;
+    bool               down;
+    bool               held;
+#endif
 } buttons_t;
 
 static buttons_t  buttons;
@@ -91,6 +101,49 @@ void buttons_event(const struct device * gpiob,
     k_work_submit(&buttons.work);
 }
 
+#if defined(CONFIG_CALIPER_BURST)
+/*---------------------------------------------------------------------------*/
+/*  Still down after HOLD_MS: a hold, not a press.                           */
+/*---------------------------------------------------------------------------*/
+static void buttons_hold_worker(struct k_work * work)
+{
+    buttons.held = true;
+
+    if (buttons.hold) {
+        buttons.hold(buttons.current->id, true);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Both edges: a press is reported on release, unless it became a hold.    */
+/*---------------------------------------------------------------------------*/
+static void buttons_worker(struct k_work * work)
+{
+    int state;
+
+    k_msleep(DEBOUNCE_MS);
+    state = gpio_pin_get(gpiob, buttons.current->pin);
+
+    if (state == 1 && !buttons.down) {
+        buttons.down = true;
+        buttons.held = false;
+        k_work_schedule(&buttons.hold_work, K_MSEC(HOLD_MS - DEBOUNCE_MS));
+    }
+    else if (state == 0 && buttons.down) {
+        buttons.down = false;
+        /* Same work queue as the hold worker: held is settled here. */
+        k_work_cancel_delayable(&buttons.hold_work);
+        if (buttons.held) {
+            if (buttons.hold) {
+                buttons.hold(buttons.current->id, false);
+            }
+        }
+        else if (buttons.notify) {
+            buttons.notify(buttons.current->id);
+        }
+    }
+}
+#else
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -105,6 +158,7 @@ static void buttons_worker(struct k_work * work)
         }
     }
 }
+#endif
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -122,6 +176,16 @@ void buttons_unregister_notify_handler(void)
     buttons.notify = NULL;
 }
 
+#if defined(CONFIG_CALIPER_BURST)
+/*---------------------------------------------------------------------------*/
+/*  Hold start (held true) and release (held false) notifications.          */
+/*---------------------------------------------------------------------------*/
+void buttons_register_hold_handler(buttons_hold_t hold)
+{
+    buttons.hold = hold;
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*  Trigger remote button event -- driven by shell "snap" cmd.               */
 /*---------------------------------------------------------------------------*/
@@ -157,6 +221,9 @@ void buttons_init(void)
     }
 
     k_work_init(&buttons.work, buttons_worker);
+#if defined(CONFIG_CALIPER_BURST)
+    k_work_init_delayable(&buttons.hold_work, buttons_hold_worker);
+#endif
 
     //LOG_INF("SW0_PIN: %d", SW0_PIN);
 
@@ -170,7 +237,12 @@ void buttons_init(void)
 //    gpio_pin_configure(gpiob, SW2_PIN, flags);
 //    gpio_pin_configure(gpiob, SW3_PIN, flags);
 
+#if defined(CONFIG_CALIPER_BURST)
+    /* Releases matter too: they end a hold. */
+    gpio_pin_interrupt_configure(gpiob, SW0_PIN, GPIO_INT_EDGE_BOTH);
+#else
     gpio_pin_interrupt_configure(gpiob, SW0_PIN, GPIO_INT_EDGE_TO_ACTIVE);
+#endif
 //    gpio_pin_interrupt_configure(gpiob, SW1_PIN, GPIO_INT_EDGE_TO_ACTIVE);
 //    gpio_pin_interrupt_configure(gpiob, SW2_PIN, GPIO_INT_EDGE_TO_ACTIVE);
 //    gpio_pin_interrupt_configure(gpiob, SW3_PIN, GPIO_INT_EDGE_TO_ACTIVE);
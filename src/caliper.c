@@ -8,13 +8,33 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
 #include <stdlib.h>
 
+#if defined(CONFIG_CALIPER_CAPTURE_GPIO)
+#include <nrfx_timer.h>
+#endif
+
 #include "caliper.h"
 #include "caliper_gpio.h"
 #include "keyboard.h"
 #include "buttons.h"
 #include "framer.h"
+#include "spis_capture.h"
+#include "edge_capture.h"
+#include "readings.h"
+#include "phase.h"
+#include "decoder.h"
+#include "activity.h"
+#include "sigmon.h"
+#include "validate.h"
+#include "autocap.h"
+#include "units.h"
+#include "filter.h"
+#include "datum.h"
+#include "burst.h"
+#include "peak.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(caliper, LOG_LEVEL_INF);
@@ -23,45 +43,113 @@ LOG_MODULE_REGISTER(caliper, LOG_LEVEL_INF);
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
-static const struct gpio_dt_spec clock_spec = 
-                        GPIO_DT_SPEC_GET_OR(CLOCK_NODE, gpios, 0);
+#define CALIPER_THREAD_STACK_SIZE  1024
+#define CALIPER_THREAD_PRIORITY    5
 
-static const struct gpio_dt_spec data_spec = 
-                        GPIO_DT_SPEC_GET_OR(DATA_NODE, gpios, 0);
+/* No frame for this long: the caliper is off (see framer_active_timer). */
+#define CALIPER_OFF_MS             500
 
-static struct gpio_callback clock_irq_cb_data;
+/* Frames one synchronous read may take: a retry, plus the validation vote. */
+#if defined(CONFIG_CALIPER_VALIDATE)
+#define CALIPER_READ_MAX_FRAMES    (CONFIG_CALIPER_VALIDATE_VOTE_M + 2)
+#else
+#define CALIPER_READ_MAX_FRAMES    2
+#endif
 
-static void caliperBackend(void * unused);
+#define HIGH        1
+#define LOW         0
 
-#define CALIPER_THREAD_STACK_SIZE  1024
-#define CALIPER_THREAD_PRIORITY    5
+/*
+ *  One channel per "caliper" devicetree node, each with its own pins,
+ *  backend thread and result.
+ */
+typedef struct {
+    int                  index;
+    struct gpio_dt_spec  clock_spec;
+    struct gpio_dt_spec  data_spec;
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+    struct gpio_dt_spec  req_spec;
+#endif
+    struct gpio_callback clock_irq_cb_data;
 
-K_THREAD_DEFINE(caliper_thread, 
-                CALIPER_THREAD_STACK_SIZE, 
-                caliperBackend, 
-                NULL, NULL, NULL, 
-                CALIPER_THREAD_PRIORITY, 0, 0);
+    struct k_sem         gpio_sem;
+    struct k_thread      thread;
 
-K_SEM_DEFINE(caliper_gpio_sem, 0, 1);
+    /*
+     *  Outstanding read requests, oldest first; armed while any are
+     *  (in continuous mode, always).
+     */
+    struct k_spinlock    lock;
+    sys_slist_t          requests;
+    bool                 armed;
 
-K_SEM_DEFINE(caliper_read_done_sem, 0, 1);
+    /*
+     *  Serializes the arm/disarm pin calls; arm_gen (under lock) counts
+     *  arms, so a disarm decided before a re-arm can tell it is stale.
+     */
+    struct k_mutex       arm_mutex;
+    uint32_t             arm_gen;
 
-/*---------------------------------------------------------------------------*/
-/*                                                                           */
-/*---------------------------------------------------------------------------*/
+    int                  current_status;
 
-#define CALIPER_FRAME_VALUE_BITS  16
-#define CALIPER_FRAME_FLAG_BITS   20
-#define CALIPER_FRAME_TOTAL_BITS  24
+    /*
+     *  Latest good reading, double buffered: the backend fills the
+     *  slot readers are not using, then bumps latest_seq to flip.
+     */
+    caliper_latest_t     latest [2];
+    atomic_t             latest_seq;    // 0 until the first reading
 
-#define CALIPER_FRAME_FLAG_SIGN_BIT 21
+#if defined(CONFIG_CALIPER_CAPTURE_GPIO)
+    /*
+     *  Units flag, sampled by the TIMER3 CC[n] compare interrupt.
+     */
+    struct k_sem         units_sem;
+    int                  units;
+#endif
 
-#define HIGH        1
-#define LOW         0
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR) && defined(CONFIG_CALIPER_CAPTURE_GPIO)
+    uint32_t             last_edge;     // k_cycle_get_32(), previous frame
+#endif
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    /*
+     *  Frame timing for the phase tracker (usecs, phase_now_us() base).
+     */
+    int64_t              frame_start;
+    int64_t              frame_end;
+#endif
+} caliper_channel_t;
+
+#define CALIPER_CHANNEL_INIT(node)                                            \
+    {                                                                         \
+        .clock_spec = GPIO_DT_SPEC_GET(CHANNEL_CLOCK_NODE(node), gpios),      \
+        .data_spec  = GPIO_DT_SPEC_GET(CHANNEL_DATA_NODE(node), gpios),       \
+        IF_ENABLED(CONFIG_CALIPER_CAPTURE_DIGIMATIC,                          \
+            (.req_spec = GPIO_DT_SPEC_GET_OR(CHANNEL_REQ_NODE(node),          \
+                                             gpios, {0}),))                   \
+    },
+
+static caliper_channel_t channels [] = {
+    DT_FOREACH_STATUS_OKAY(caliper, CALIPER_CHANNEL_INIT)
+};
+
+BUILD_ASSERT(DT_SAME_NODE(DT_INST(0, caliper), CALIPER_NODE),
+             "channel 0 must be the caliper the caliper-* aliases point into");
+
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
+BUILD_ASSERT(CALIPER_CHANNELS == 1, "SPIS capture serves a single caliper");
+#endif
+
+K_THREAD_STACK_ARRAY_DEFINE(caliper_stacks, CALIPER_CHANNELS, 
+                            CALIPER_THREAD_STACK_SIZE);
 
-static int   current_frame;
-static short current_value;
-static int   current_standard;
+/*
+ *  Request deadlines run on their own queue: a synchronous read made
+ *  from the system workqueue (SNAPSHOT) must not wait on itself.
+ */
+K_THREAD_STACK_DEFINE(caliper_deadline_stack, CALIPER_THREAD_STACK_SIZE);
+
+static struct k_work_q caliper_deadline_q;
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -79,118 +167,1052 @@ static void caliperWrite(const struct gpio_dt_spec * spec, int val)
     gpio_pin_set_dt(spec, val);
 }
 
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  SPIS engine: EasyDMA collects the frame, this thread only sleeps.        */
 /*---------------------------------------------------------------------------*/
-static void caliperBackend(void * unused)
+static int caliperCaptureFrame(caliper_channel_t * ch, caliper_frame_t * frame)
+{
+    uint32_t bit_us = decoder_bit_period_us(ch->index);
+    int      frame_bits = decoder_frame_bits(ch->index);
+    uint32_t units_us;
+    uint32_t duration;
+    int bits;
+    int units;
+    int ret;
+
+    /*
+     *  Units flag: a units delay past the last edge, as the other engines
+     *  sample it.  Until a bit period is measured, the fixed frame time.
+     */
+    if (bit_us != 0 && frame_bits > 1) {
+        units_us = bit_us * (frame_bits - 1) + decoder_units_delay_us(ch->index);
+    }
+    else {
+        units_us = CONFIG_CALIPER_FRAME_TIME_US;
+    }
+
+    ret = spis_capture_frame(units_us, &frame->data, &bits, &units, &duration);
+    if (ret == 0) {
+        frame->bits     = bits;
+        frame->units    = units;
+        frame->duration = duration;
+    }
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    ch->frame_end = ch->frame_start + duration;
+#endif
+    return ret;
+}
+
+#elif defined(CONFIG_CALIPER_CAPTURE_EDGE)
+/*---------------------------------------------------------------------------*/
+/*  Edge engine: frame already assembled from timestamped clock edges.       */
+/*---------------------------------------------------------------------------*/
+static int caliperCaptureFrame(caliper_channel_t * ch, caliper_frame_t * frame)
+{
+    edge_frame_t edge_frame;
+
+    if (edge_capture_get_frame(ch->index, &edge_frame, K_FOREVER) != 0) {
+        return -EIO;
+    }
+
+    /*
+     *  Gap threshold follows the measured frame rate (fast mode).
+     */
+    edge_capture_set_gap_us(ch->index, framer_gap_us(ch->index));
+
+    frame->data     = edge_frame.frame;
+    frame->bits     = edge_frame.bits;
+    frame->units    = edge_frame.units;
+    frame->duration = edge_frame.end - edge_frame.start;
+
+    return 0;
+}
+
+#elif defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+/*---------------------------------------------------------------------------*/
+/*  Digimatic engine: the gauge answered REQ; poll in the 13 nibbles.        */
+/*---------------------------------------------------------------------------*/
+static int caliperCaptureFrame(caliper_channel_t * ch, caliper_frame_t * frame)
 {
     int i;
-    int sign;
     int bit;
     int lockkey;
+    int bits;
+    bool stopped = false;
+    uint32_t first;
+    uint32_t edge;
+    uint32_t gap_cycles = k_us_to_cyc_ceil32(CONFIG_CALIPER_GAP_US);
 
-    LOG_INF("%s: waiting for work...", __func__);
+    /*
+     *  Gauge has started clocking: REQ may be released.
+     */
+    caliperWrite(&ch->req_spec, 0);
 
-    while (1) {
+    bits = decoder_frame_bits(ch->index);
+    if (bits == 0) {
+        bits = DECODER_MAX_BITS;
+    }
+
+    i = 0;
+    frame->data = 0;
+    first = edge = k_cycle_get_32();
 
-        k_sem_take(&caliper_gpio_sem, K_FOREVER);
+    if (caliperRead(&ch->data_spec) == HIGH) {
+        frame->data |= BIT64(i);
+    }
 
-        i = 0;
-        sign = 1;
+    for (i=1; i < bits; i++) {
 
-        current_frame = 0;
-        current_value = 0;
-        current_standard = 0;
+        /*  Disable all interrupts while reading next data bit. */
+        lockkey = irq_lock();
 
         /*
-         *  Save initial data value caused by interrupt
-         *  Note: It takes ~9 msecs to read whole frame.
+         *  The gauge may stop early (unplugged, or a short frame):
+         *  don't spin forever on either clock level.
          */
-        if (caliperRead(&data_spec) == 0) {
-            current_value |= 1 << i;
-            current_frame |= 1 << i;
+        while (caliperRead(&ch->clock_spec) == LOW) {
+            if (k_cycle_get_32() - edge >= gap_cycles) {
+                stopped = true;
+                break;
+            }
+        }
+        while (!stopped && caliperRead(&ch->clock_spec) == HIGH) {
+            if (k_cycle_get_32() - edge >= gap_cycles) {
+                stopped = true;
+                break;
+            }
+        }
+
+        bit = caliperRead(&ch->data_spec);
+
+        /*  Re-enable all interrupts */
+        irq_unlock(lockkey);
+
+        if (stopped) {
+            break;
+        }
+        edge = k_cycle_get_32();
+
+        if (bit == HIGH) {
+            frame->data |= BIT64(i);
+        }
+    }
+
+    frame->bits     = i;
+    frame->units    = -1;     /* carried in the frame */
+    frame->duration = k_cyc_to_us_floor32(edge - first);
+
+    return 0;
+}
+
+#else  /* CONFIG_CALIPER_CAPTURE_GPIO */
+
+/*
+ *  TIMER3 (1 MHz, free running) schedules the units flag sample of
+ *  channel n on CC[n], so the thread sleeps instead of spinning.
+ */
+#define UNITS_TIMER_NODE  DT_NODELABEL(timer3)
+
+BUILD_ASSERT(CALIPER_CHANNELS <= 6, "TIMER3 has 6 CC registers");
+
+static const nrfx_timer_t units_timer = NRFX_TIMER_INSTANCE(3);
+
+/* Closer than this, a compare is not worth it: just read. */
+#define UNITS_LEAD_US     10
+
+/*---------------------------------------------------------------------------*/
+/*  Compare at last edge + units delay: sample DATA now.                     */
+/*---------------------------------------------------------------------------*/
+static void caliperUnitsHandler(nrf_timer_event_t event, void * context)
+{
+    caliper_channel_t * ch;
+    int i;
+
+    ARG_UNUSED(context);
+
+    for (i=0; i < CALIPER_CHANNELS; i++) {
+        ch = &channels[i];
+        if (event == nrf_timer_compare_event_get(i)) {
+            nrfx_timer_compare_int_disable(&units_timer, BIT(i));
+            ch->units = caliperRead(&ch->data_spec);
+            k_sem_give(&ch->units_sem);
         }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Sample the out-of-frame units flag, the calibrated delay after the last  */
+/*  clock edge (k_cycle_get_32() time base).                                 */
+/*---------------------------------------------------------------------------*/
+static int caliperSampleUnits(caliper_channel_t * ch, uint32_t edge)
+{
+    uint32_t delay   = decoder_units_delay_us(ch->index);
+    uint32_t elapsed = k_cyc_to_us_floor32(k_cycle_get_32() - edge);
+    uint32_t now;
+
+    /*
+     *  Too close to bother with a compare (or already past it).
+     */
+    if (elapsed + UNITS_LEAD_US >= delay) {
+        return caliperRead(&ch->data_spec);
+    }
+
+    k_sem_reset(&ch->units_sem);
+
+    now = nrfx_timer_capture(&units_timer, ch->index);
+    nrfx_timer_compare(&units_timer, ch->index, now + (delay - elapsed), true);
+
+    if (k_sem_take(&ch->units_sem, K_USEC(delay + 1000)) != 0) {
+        nrfx_timer_compare_int_disable(&units_timer, BIT(ch->index));
+        return caliperRead(&ch->data_spec);
+    }
+    return ch->units;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void caliperUnitsInit(void)
+{
+    nrfx_err_t err;
+
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+    IRQ_CONNECT(DT_IRQN(UNITS_TIMER_NODE), DT_IRQ(UNITS_TIMER_NODE, priority),
+                nrfx_isr, nrfx_timer_3_irq_handler, 0);
+
+    err = nrfx_timer_init(&units_timer, &timer_cfg, caliperUnitsHandler);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: units timer init failed", err);
+        return;
+    }
 
-        for (i=1; i < (CALIPER_FRAME_TOTAL_BITS); i++) {
+    nrfx_timer_enable(&units_timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  GPIO engine: poll each bit with interrupts masked.                       */
+/*---------------------------------------------------------------------------*/
+static int caliperCaptureFrame(caliper_channel_t * ch, caliper_frame_t * frame)
+{
+    int i;
+    int bit;
+    int lockkey;
+    int bits;
+    int units = -1;
+    bool gap = false;
+    bool stuck = false;
+    uint32_t first;
+    uint32_t edge;
+    uint32_t idle;
+    uint32_t gap_us       = framer_gap_us(ch->index);
+    uint32_t gap_cycles   = k_us_to_cyc_ceil32(gap_us);
+    uint32_t units_cycles = k_us_to_cyc_ceil32(decoder_units_delay_us(ch->index));
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+    uint32_t rise = 0;
+    uint32_t fall = 0;
+    uint32_t last_fall = 0;     // none yet: first edge time is late
+#endif
 
-            /*  Disable all interrupts while reading next data bit. */
-            lockkey = irq_lock();
+    /*
+     *  Protocol still being detected: read until the interframe gap.
+     */
+    bits = decoder_frame_bits(ch->index);
+    if (bits == 0) {
+        bits = DECODER_MAX_BITS;
+    }
 
-            while (caliperRead(&clock_spec) == LOW)  { /*spin*/}
-            while (caliperRead(&clock_spec) == HIGH) { /*spin*/}
+    i = 0;
+    frame->data = 0;
+    first = edge = k_cycle_get_32();
 
-            bit = caliperRead(&data_spec);
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+    if (ch->last_edge != 0 && 
+        first - ch->last_edge < k_ms_to_cyc_floor32(CALIPER_OFF_MS)) {
+        sigmon_width(ch->index, SIGMON_GAP, 
+                     k_cyc_to_us_floor32(first - ch->last_edge));
+    }
+#endif
 
-            /*  Re-enable all interrupts */
-            irq_unlock(lockkey);
+    /*
+     *  Save initial data value caused by interrupt, same polarity as
+     *  the rest of the frame (and as the other engines).
+     *  Note: It takes framer_frame_us() to read whole frame: ~9 msecs,
+     *  whatever the frame rate; fast mode shortens the gap instead.
+     */
+    if (caliperRead(&ch->data_spec) == HIGH) {
+        frame->data |= BIT64(i);
+    }
 
-            if (bit == HIGH) {
-                current_frame |= 1 << i;
+    for (i=1; i < bits; i++) {
 
-                if (i < CALIPER_FRAME_VALUE_BITS) {
-                    current_value |= 1 << i;
-                }
+        /*  Disable all interrupts while reading next data bit. */
+        lockkey = irq_lock();
 
-                if (i == CALIPER_FRAME_FLAG_SIGN_BIT) {
-                    sign = -1;
-                }
+        /*
+         *  CLOCK held low for the gap time: the caliper lost power (or
+         *  its cable) mid-frame.  Don't spin on it with interrupts off.
+         */
+        while (caliperRead(&ch->clock_spec) == LOW) {
+            if (k_cycle_get_32() - edge >= gap_cycles) {
+                stuck = true;
+                break;
             }
-            else {
-                current_frame &= ~(1 << i);
-            }           
         }
 
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+        rise = k_cycle_get_32();
+#endif
+
         /*
-         *   Delay 280us, then do final data read for mode.
-         *   This catches the odd, out-of-frame mode flag after the frame.
-         *   For mm-mode, the data read will be high at end of this wait.
-         *   For in-mode, the data read will be low at end of this wait.
-         *   The 280us was derived from logic analyzer traces (emperically).
+         *  A clock idle for the gap time ends the frame: short frame,
+         *  caliper switched off, or length not known yet.  The units
+         *  flag goes by on the way.
          */
-        k_busy_wait(280);   // hard spin, not a true wait.
+        while (!stuck && caliperRead(&ch->clock_spec) == HIGH) {
+            idle = k_cycle_get_32() - edge;
+            if (units < 0 && idle >= units_cycles) {
+                units = caliperRead(&ch->data_spec);
+            }
+            if (idle >= gap_cycles) {
+                gap = true;
+                break;
+            }
+        }
+
+        bit = caliperRead(&ch->data_spec);
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+        fall = k_cycle_get_32();
+#endif
+
+        /*  Re-enable all interrupts */
+        irq_unlock(lockkey);
+
+        if (stuck) {
+            return -ETIMEDOUT;
+        }
+        if (gap) {
+            break;
+        }
+        edge  = k_cycle_get_32();
+        units = -1;
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+        if (last_fall != 0) {
+            sigmon_width(ch->index, SIGMON_LOW, 
+                         k_cyc_to_us_floor32(rise - last_fall));
+            sigmon_width(ch->index, SIGMON_PERIOD, 
+                         k_cyc_to_us_floor32(fall - last_fall));
+        }
+        sigmon_width(ch->index, SIGMON_HIGH, k_cyc_to_us_floor32(fall - rise));
+        last_fall = fall;
+#endif
 
-        bit = caliperRead(&data_spec);
         if (bit == HIGH) {
-            current_standard = CALIPER_STANDARD_INCH;
+            frame->data |= BIT64(i);
+        }
+    }
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    ch->frame_end = phase_now_us();
+    if (gap) {
+        ch->frame_end -= gap_us;
+    }
+#endif
+
+    if (!gap) {
+        /*
+         *   Final data read for mode, the units delay after the last edge.
+         *   This catches the odd, out-of-frame mode flag after the frame.
+         *   For mm-mode, the data read will be high at that point.
+         *   For in-mode, the data read will be low at that point.
+         *   The delay scales with this caliper's measured bit period;
+         *   until there is one, the 280us from logic analyzer traces.
+         */
+        units = caliperSampleUnits(ch, edge);
+    }
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+    ch->last_edge = edge;
+#endif
+
+    frame->bits     = i;
+    frame->units    = units;
+    frame->duration = k_cyc_to_us_floor32(edge - first);
+
+    return 0;
+}
+#endif
+
+/*---------------------------------------------------------------------------*/
+/*  Start watching for the next frame.                                       */
+/*---------------------------------------------------------------------------*/
+static int caliperArm(caliper_channel_t * ch)
+{
+    int ret = 0;
+
+    k_mutex_lock(&ch->arm_mutex, K_FOREVER);
+
+#if defined(CONFIG_CALIPER_CAPTURE_EDGE)
+    /*
+     *  The edge engine is always running: skip anything it completed
+     *  before this request and let the backend wait for the next one.
+     *  In continuous mode every queued frame is wanted.
+     */
+#if !defined(CONFIG_CALIPER_CONTINUOUS)
+    edge_capture_flush(ch->index);
+#endif
+    edge_capture_set_frame_bits(ch->index, decoder_frame_bits(ch->index));
+    k_sem_give(&ch->gpio_sem);
+#else
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
+    /*
+     *  Open the SPIS transaction while still in the interframe gap,
+     *  and watch for the frame's first edge.
+     */
+    if (spis_capture_arm() != 0) {
+        ret = -EIO;
+    }
+#else
+    /* 
+     *  Set interrupts on falling edge (HIGH --> LOW)
+     */
+    gpio_pin_interrupt_configure_dt(&ch->clock_spec, GPIO_INT_EDGE_FALLING);
+#endif
+
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+    /*
+     *  Ask the gauge for a frame; released again at its first clock.
+     */
+    caliperWrite(&ch->req_spec, 1);
+#endif
+#endif
+
+    k_mutex_unlock(&ch->arm_mutex);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void caliperDisarm(caliper_channel_t * ch)
+{
+    k_mutex_lock(&ch->arm_mutex, K_FOREVER);
+
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
+    spis_capture_disarm();
+#elif !defined(CONFIG_CALIPER_CAPTURE_EDGE)
+    gpio_pin_interrupt_configure_dt(&ch->clock_spec, GPIO_INT_DISABLE);
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    if (ch->index == 0) {
+        activity_resume();
+    }
+#endif
+#endif
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+    caliperWrite(&ch->req_spec, 0);
+#endif
+
+    k_mutex_unlock(&ch->arm_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Disarm, unless the channel has been armed again since arm_gen was gen.   */
+/*---------------------------------------------------------------------------*/
+static void caliperDisarmIdle(caliper_channel_t * ch, uint32_t gen)
+{
+    bool stale;
+
+    k_mutex_lock(&ch->arm_mutex, K_FOREVER);
+
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    stale = (ch->arm_gen != gen);
+    k_spin_unlock(&ch->lock, key);
+
+    if (!stale) {
+        caliperDisarm(ch);
+    }
+
+    k_mutex_unlock(&ch->arm_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Publish a good reading.  Only the channel's backend thread writes.       */
+/*---------------------------------------------------------------------------*/
+static void caliperPublish(caliper_channel_t * ch,
+                           const caliper_reading_t * reading)
+{
+    uint32_t seq = (uint32_t) atomic_get(&ch->latest_seq) + 1;
+    caliper_latest_t * slot = &ch->latest[seq & 1];
+
+    slot->value     = reading->value;
+    slot->standard  = reading->standard;
+    slot->timestamp = reading->timestamp;
+    slot->seq       = seq;
+
+    barrier_dmem_fence_full();
+    atomic_set(&ch->latest_seq, seq);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Consistent copy of the latest good reading, without locking.            */
+/*                                                                           */
+/*  The slot being copied is only rewritten two publications later, so a     */
+/*  reader retries only if the backend got that far meanwhile; it never      */
+/*  waits on a writer it has preempted.  If seen is given, returns           */
+/*  -EALREADY when latest->seq equals *seen, and stores the new seq.         */
+/*---------------------------------------------------------------------------*/
+int caliper_latest(int channel, caliper_latest_t * latest, uint32_t * seen)
+{
+    caliper_channel_t * ch;
+    uint32_t seq;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+    ch = &channels[channel];
+
+    do {
+        seq = (uint32_t) atomic_get(&ch->latest_seq);
+        if (seq == 0) {
+            return -ENODATA;
+        }
+        *latest = ch->latest[seq & 1];
+
+        barrier_dmem_fence_full();
+    } while ((uint32_t) atomic_get(&ch->latest_seq) - seq > 1);
+
+    if (seen) {
+        if (*seen == seq) {
+            return -EALREADY;
+        }
+        *seen = seq;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Complete a request exactly once, by whoever gets there first: the        */
+/*  backend, the deadline or a cancel.  Not from interrupt level.            */
+/*---------------------------------------------------------------------------*/
+static bool caliperComplete(caliper_channel_t * ch, caliper_request_t * request,
+                            int result, bool from_timeout)
+{
+    caliper_callback_t     callback;
+    struct k_poll_signal * signal;
+    struct k_msgq *        msgq;
+    struct k_work_sync     sync;
+    uint32_t gen;
+    bool idle;
+
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+
+    if (!request->pending) {
+        k_spin_unlock(&ch->lock, key);
+        return false;
+    }
+    sys_slist_find_and_remove(&ch->requests, &request->node);
+    request->pending = false;
+
+    idle = sys_slist_is_empty(&ch->requests) && ch->armed;
+    if (idle && !IS_ENABLED(CONFIG_CALIPER_CONTINUOUS)) {
+        ch->armed = false;
+    }
+    else {
+        idle = false;
+    }
+    gen = ch->arm_gen;
+
+    k_spin_unlock(&ch->lock, key);
+
+    /*
+     *  Nobody is waiting for a frame any more: stop watching for one,
+     *  unless a new request has armed again meanwhile.
+     */
+    if (idle) {
+        caliperDisarmIdle(ch, gen);
+    }
+
+    if (!from_timeout) {
+        k_work_cancel_delayable_sync(&request->timeout_work, &sync);
+    }
+
+    request->result = result;
+    if (result == 0) {
+        caliper_latest_t latest;
+
+        caliper_latest(ch->index, &latest, NULL);
+        request->value    = latest.value;
+        request->standard = latest.standard;
+    }
+
+    /*
+     *  The request may be reused as soon as it is notified.
+     */
+    callback = request->callback;
+    signal   = request->signal;
+    msgq     = request->msgq;
+
+    if (msgq) {
+        k_msgq_put(msgq, &request, K_NO_WAIT);
+    }
+    if (signal) {
+        k_poll_signal_raise(signal, result);
+    }
+    if (callback) {
+        callback(request);
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Request deadline, on the caliper deadline queue.                         */
+/*---------------------------------------------------------------------------*/
+static void caliperTimeout(struct k_work * work)
+{
+    struct k_work_delayable * dwork = k_work_delayable_from_work(work);
+    caliper_request_t * request = CONTAINER_OF(dwork, caliper_request_t,
+                                               timeout_work);
+    caliper_channel_t * ch = &channels[request->channel];
+
+    if (caliperComplete(ch, request, -ETIMEDOUT, true)) {
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+        if (ch->index == 0) {
+            phase_unlock();
+        }
+#endif
+        LOG_WRN("%s: %d: no frame", __func__, ch->index);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  After each frame: hand a good reading (or a hard error) to every         */
+/*  outstanding request, otherwise keep them waiting for the next frame.    */
+/*---------------------------------------------------------------------------*/
+static void caliperFinish(caliper_channel_t * ch)
+{
+    int status = ch->current_status;
+    caliper_request_t * request;
+    bool rearm;
+
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    rearm = !sys_slist_is_empty(&ch->requests);
+    k_spin_unlock(&ch->lock, key);
+
+    /*
+     *  A frame caught mid-way, out of phase, not yet decodable or
+     *  not yet validated: the next one will do, deadline permitting.
+     */
+    if (status != 0 && status != -EIO) {
+        if (rearm && !IS_ENABLED(CONFIG_CALIPER_CONTINUOUS) &&
+            caliperArm(ch) != 0) {
+            status = -EIO;
         }
         else {
-            current_standard = CALIPER_STANDARD_MM;
+            return;
+        }
+    }
+
+    while (1) {
+        key = k_spin_lock(&ch->lock);
+        request = SYS_SLIST_PEEK_HEAD_CONTAINER(&ch->requests, request, node);
+        k_spin_unlock(&ch->lock, key);
+
+        if (request == NULL) {
+            break;
+        }
+        caliperComplete(ch, request, status, false);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start an asynchronous read; completes through the request's callback,    */
+/*  poll signal and/or message queue, with the result in request->result.   */
+/*---------------------------------------------------------------------------*/
+int caliper_read_async(caliper_request_t * request)
+{
+    caliper_channel_t * ch;
+    bool arm;
+
+    if (request->channel < 0 || request->channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+    if (request->pending) {
+        return -EBUSY;
+    }
+
+    ch = &channels[request->channel];
+
+    request->result  = -EINPROGRESS;
+    request->pending = true;
+
+    /*
+     *  Deadline first: once listed, the request may complete (and be
+     *  reused by its owner) at any time.
+     */
+    k_work_init_delayable(&request->timeout_work, caliperTimeout);
+    if (!K_TIMEOUT_EQ(request->timeout, K_FOREVER)) {
+        k_work_schedule_for_queue(&caliper_deadline_q, &request->timeout_work,
+                                  request->timeout);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+
+    if (!request->pending) {
+        k_spin_unlock(&ch->lock, key);   // already timed out
+        return 0;
+    }
+    sys_slist_append(&ch->requests, &request->node);
+
+    arm = !ch->armed;
+    ch->armed = true;
+    if (arm) {
+        ch->arm_gen++;
+    }
+
+    k_spin_unlock(&ch->lock, key);
+
+#if !defined(CONFIG_CALIPER_CONTINUOUS)
+    if (arm && caliperArm(ch) != 0) {
+        caliperComplete(ch, request, -EIO, false);
+    }
+#else
+    ARG_UNUSED(arm);
+#endif
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Returns -EALREADY if the request had completed already.                  */
+/*---------------------------------------------------------------------------*/
+int caliper_read_cancel(caliper_request_t * request)
+{
+    caliper_channel_t * ch = &channels[request->channel];
+
+    if (caliperComplete(ch, request, -ECANCELED, false)) {
+        return 0;
+    }
+    return -EALREADY;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  One backend thread per channel.                                          */
+/*---------------------------------------------------------------------------*/
+static void caliperBackend(void * p1, void * p2, void * p3)
+{
+    caliper_channel_t * ch = p1;
+    caliper_frame_t frame;
+    int32_t value;
+    int standard;
+    caliper_reading_t reading;
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    LOG_INF("%s: %d waiting for work...", __func__, ch->index);
+
+#if defined(CONFIG_CALIPER_CONTINUOUS) && !defined(CONFIG_CALIPER_CAPTURE_EDGE)
+    /*
+     *  Align once; afterwards each frame re-arms from within the gap.
+     *  Other channels need no framer: a frame entered mid-way comes
+     *  up short and is rejected, and the re-arm then lands in the gap.
+     */
+    if (ch->index == 0) {
+        while (1) {
+            framer_find_interframe_gap();
+            if (is_caliper_on()) {
+                break;
+            }
+            k_sleep(K_MSEC(CALIPER_OFF_MS));   // framer may not block
+        }
+    }
+#endif
+
+    while (1) {
+
+#if defined(CONFIG_CALIPER_CONTINUOUS)
+        if (caliperArm(ch) != 0) {
+            k_sleep(K_MSEC(100));
+            continue;
+        }
+#endif
+        k_sem_take(&ch->gpio_sem, K_FOREVER);
+
+        ch->current_status = caliperCaptureFrame(ch, &frame);
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+        /*
+         *  A frame that did not start where predicted was caught
+         *  part way through: throw it away (caller will re-align).
+         *  Only channel 0 is framed, so only it is phase tracked.
+         */
+        if (ch->index == 0 && ch->current_status == 0 && 
+            !phase_frame(ch->frame_start, ch->frame_end)) {
+            ch->current_status = -EAGAIN;
+        }
+#endif
+        if (ch->current_status == 0) {
+            ch->current_status = decoder_decode(ch->index, &frame, &value,
+                                                &standard);
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+            sigmon_frame(ch->index, &frame, ch->current_status);
+#endif
+        }
+        if (ch->current_status == 0) {
+            reading.timestamp = k_uptime_ticks();
+            reading.value     = value;
+            reading.standard  = standard;
+            reading.flags     = READING_FLAG_VALID;
+            reading.channel   = ch->index;
+
+#if defined(CONFIG_CALIPER_VALIDATE)
+            /*
+             *  Rejected and not-yet-confirmed readings are kept too,
+             *  flagged, but not returned as the value.
+             */
+            ch->current_status = validate_reading(&reading);
+#endif
+            readings_put(&reading);
+
+            /*
+             *  A good reading then goes, in this order, through the
+             *  units policy, filter and datum (the history above keeps
+             *  it as decoded), is published to requests and snapshots,
+             *  and is handed as published to auto-capture and burst.
+             *  Peak hold gets it unfiltered, datum applied: smoothing
+             *  would shave the extremes it is there to catch.
+             *  Continuous mode feeds these every frame.
+             */
+            if (ch->current_status == 0) {
+#if defined(CONFIG_CALIPER_PEAK)
+                caliper_reading_t unfiltered;
+#endif
+                units_apply(&reading);
+#if defined(CONFIG_CALIPER_PEAK)
+                unfiltered = reading;
+#endif
+#if defined(CONFIG_CALIPER_FILTER)
+                filter_reading(&reading);
+#endif
+#if defined(CONFIG_CALIPER_DATUM)
+                datum_apply(&reading);
+#endif
+                caliperPublish(ch, &reading);
+#if defined(CONFIG_CALIPER_AUTO_CAPTURE)
+                autocap_reading(&reading);
+#endif
+#if defined(CONFIG_CALIPER_BURST)
+                burst_reading(&reading);
+#endif
+#if defined(CONFIG_CALIPER_PEAK)
+#if defined(CONFIG_CALIPER_DATUM)
+                datum_relative(&unfiltered);
+#endif
+                peak_reading(&unfiltered);
+#endif
+            }
         }
 
-        current_value = current_value / 2;
-        if (current_standard == CALIPER_STANDARD_INCH) 
-            current_value /= 2;
-        current_value *= sign;
+        caliperDisarm(ch);
+
+        caliperFinish(ch);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Synchronous reads: wait for the request to complete.                     */
+/*---------------------------------------------------------------------------*/
+static void caliperReadDone(caliper_request_t * request)
+{
+    k_sem_give(request->user_data);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Deadline for a synchronous read (msecs): CALIPER_READ_MAX_FRAMES frames, */
+/*  each given as long as a caliper that is on can take to send one.         */
+/*---------------------------------------------------------------------------*/
+static uint32_t caliperReadTimeoutMs(caliper_channel_t * ch)
+{
+    uint32_t frame_ms = CALIPER_OFF_MS;
 
-        k_sem_give(&caliper_read_done_sem);
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    /*
+     *  Armed on a prediction: if nothing arrives within two periods,
+     *  the caliper has gone quiet (likely powered off).
+     */
+    phase_stats_t stats;
 
-        gpio_pin_interrupt_configure_dt(&clock_spec, GPIO_INT_DISABLE);
+    phase_get_stats(&stats);
+    if (ch->index == 0 && stats.locked) {
+        frame_ms = (2 * stats.period + CONFIG_CALIPER_FRAME_TIME_US) / 1000;
     }
+#endif
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+    /*
+     *  No answer to REQ: gauge is off or unplugged.
+     */
+    frame_ms = CONFIG_CALIPER_DIGIMATIC_TIMEOUT_MS;
+#endif
+
+    return frame_ms * CALIPER_READ_MAX_FRAMES;
 }
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-int caliper_read_value(short * value, int * standard)
+int caliper_read_channel(int channel, int32_t * value, int * standard)
 {
-    LOG_INF("%s ", __func__);
+    struct k_sem done;
+    uint32_t timeout_ms;
+    caliper_request_t request = {
+        .channel   = channel,
+        .callback  = caliperReadDone,
+        .user_data = &done,
+    };
+    int ret;
 
-    /* 
-     *  Set interrupts on falling edge (HIGH --> LOW)
+    LOG_INF("%s: %d", __func__, channel);
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+
+    k_sem_init(&done, 0, 1);
+    timeout_ms = caliperReadTimeoutMs(&channels[channel]);
+    request.timeout = K_MSEC(timeout_ms);
+
+    ret = caliper_read_async(&request);
+    if (ret != 0) {
+        return ret;
+    }
+
+    /*
+     *  The deadline completes the request; the wait is bounded as well,
+     *  in case its queue is held up.
      */
-    gpio_pin_interrupt_configure_dt(&clock_spec, GPIO_INT_EDGE_FALLING);
+    if (k_sem_take(&done, K_MSEC(timeout_ms + CALIPER_OFF_MS)) != 0 &&
+        caliper_read_cancel(&request) != 0) {
+        /* Completing just now: the callback is on its way. */
+        k_sem_take(&done, K_FOREVER);
+    }
+
+    *value    = request.value;
+    *standard = request.standard;
+
+    return request.result;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int caliper_read_value(int32_t * value, int * standard)
+{
+    return caliper_read_channel(0, value, standard);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Every channel from the same frame period: all requests go out at once,   */
+/*  then one k_poll waits on them together.  First error by channel wins.    */
+/*---------------------------------------------------------------------------*/
+int caliper_read_all(int32_t * values, int * standards)
+{
+    caliper_request_t    requests [CALIPER_CHANNELS];
+    struct k_poll_signal signals [CALIPER_CHANNELS];
+    struct k_poll_event  events [CALIPER_CHANNELS];
+    uint32_t timeout_ms = 0;
+    int64_t deadline;
+    bool cancelled = false;
+    int issued;
+    int ret = 0;
+
+    LOG_INF("%s", __func__);
+
+    for (issued = 0; issued < CALIPER_CHANNELS; issued++) {
+        uint32_t ms = caliperReadTimeoutMs(&channels[issued]);
+
+        k_poll_signal_init(&signals[issued]);
+        requests[issued] = (caliper_request_t) {
+            .channel = issued,
+            .timeout = K_MSEC(ms),
+            .signal  = &signals[issued],
+        };
+        timeout_ms = MAX(timeout_ms, ms);
+
+        ret = caliper_read_async(&requests[issued]);
+        if (ret != 0) {
+            break;
+        }
+    }
+
+    if (ret != 0) {
+        for (int i = 0; i < issued; i++) {
+            caliper_read_cancel(&requests[i]);
+        }
+    }
 
     /*
-     *  Wait for value-read to complete
+     *  The deadlines complete the requests; the wait is bounded as well,
+     *  in case their queue is held up.  Past it, cancel what is left:
+     *  a cancelled request still raises its signal.
      */
-    k_sem_take(&caliper_read_done_sem, K_FOREVER);
+    deadline = k_uptime_get() + timeout_ms + CALIPER_OFF_MS;
 
-    *value    = current_value;
-    *standard = current_standard;
+    while (1) {
+        unsigned int signaled;
+        int result;
+        int count = 0;
+
+        for (int i = 0; i < issued; i++) {
+            k_poll_signal_check(&signals[i], &signaled, &result);
+            if (!signaled) {
+                k_poll_event_init(&events[count++], K_POLL_TYPE_SIGNAL,
+                                  K_POLL_MODE_NOTIFY_ONLY, &signals[i]);
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+
+        if (cancelled) {
+            k_poll(events, count, K_FOREVER);
+        }
+        else if (k_poll(events, count,
+                        K_MSEC(MAX(deadline - k_uptime_get(), 0))) != 0) {
+            for (int i = 0; i < issued; i++) {
+                caliper_read_cancel(&requests[i]);
+            }
+            cancelled = true;
+        }
+    }
 
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (int i = 0; i < CALIPER_CHANNELS; i++) {
+        if (requests[i].result != 0) {
+            return requests[i].result;
+        }
+        values[i]    = requests[i].value;
+        standards[i] = requests[i].standard;
+    }
     return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int caliper_channel_count(void)
+{
+    return CALIPER_CHANNELS;
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -198,48 +1220,79 @@ void caliperInterrupt(const struct device * dev,
                       struct gpio_callback * cb,
                       uint32_t bitarray)
 {
-    if (bitarray & (1 << CLOCK)) {
+    caliper_channel_t * ch = CONTAINER_OF(cb, caliper_channel_t, 
+                                          clock_irq_cb_data);
+
+    if (bitarray & BIT(ch->clock_spec.pin)) {
         /*
          *  Disable interrupts, then signal backend thread to do work.
          */
-        gpio_pin_interrupt_configure_dt(&clock_spec, GPIO_INT_DISABLE);
+        gpio_pin_interrupt_configure_dt(&ch->clock_spec, GPIO_INT_DISABLE);
+
+#if defined(CONFIG_CALIPER_ACTIVITY)
+        if (ch->index == 0) {
+            activity_resume();
+        }
+#endif
 
-        k_sem_give(&caliper_gpio_sem);
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+        ch->frame_start = phase_now_us();
+#endif
+
+        k_sem_give(&ch->gpio_sem);
     }
 }
 
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
+/*---------------------------------------------------------------------------*/
+/*  First CLOCK edge of an SPIS frame, from spis_capture (interrupt level).  */
+/*---------------------------------------------------------------------------*/
+static void caliperSpisStart(void)
+{
+    caliper_channel_t * ch = &channels[0];
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    ch->frame_start = phase_now_us();
+#endif
+
+    k_sem_give(&ch->gpio_sem);
+}
+
+#endif
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-void caliperInitInterrupts(void)
+static void caliperInitInterrupts(caliper_channel_t * ch)
 {
     int ret;
 
-    if (!device_is_ready(clock_spec.port)) {
-        LOG_ERR("Error: Caliper %s is not ready", clock_spec.port->name);
+    if (!device_is_ready(ch->clock_spec.port)) {
+        LOG_ERR("Error: Caliper %s is not ready", ch->clock_spec.port->name);
         return;
     }
 
-    ret = gpio_pin_configure_dt(&clock_spec, (GPIO_PULL_DOWN | GPIO_INPUT));
+    ret = gpio_pin_configure_dt(&ch->clock_spec, (GPIO_PULL_DOWN | GPIO_INPUT));
     if (ret != 0) {
         LOG_ERR("Error %d: failed to configure %s pin %d",
-               ret, clock_spec.port->name, clock_spec.pin);
+               ret, ch->clock_spec.port->name, ch->clock_spec.pin);
         return;
     }
 
     /* 
      *  Set interrupts on rising edge (Low --> High)
      */
-    ret = gpio_pin_interrupt_configure_dt(&clock_spec, GPIO_INT_DISABLE);
+    ret = gpio_pin_interrupt_configure_dt(&ch->clock_spec, GPIO_INT_DISABLE);
     if (ret != 0) {
         LOG_ERR("%s failed %d", __func__, ret);
         return;
     }
 
-    gpio_init_callback(&clock_irq_cb_data, caliperInterrupt, BIT(clock_spec.pin));
-    gpio_add_callback(clock_spec.port, &clock_irq_cb_data);
+    gpio_init_callback(&ch->clock_irq_cb_data, caliperInterrupt, 
+                       BIT(ch->clock_spec.pin));
+    gpio_add_callback(ch->clock_spec.port, &ch->clock_irq_cb_data);
 
-    LOG_INF("Configure interrupts for %s on pin %d", CLOCK_LABEL, CLOCK);
+    LOG_INF("Configure interrupts for channel %d on pin %d", 
+            ch->index, ch->clock_spec.pin);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -247,18 +1300,71 @@ void caliperInitInterrupts(void)
 /*---------------------------------------------------------------------------*/
 void caliper_init(void)
 {
+    caliper_channel_t * ch;
+    int i;
+
     (void) caliperRead;
     (void) caliperWrite;
 
-    LOG_INF("%s", __func__);
+    LOG_INF("%s: %d channel(s)", __func__, CALIPER_CHANNELS);
 
-    /*
-     *  Initialize interrupts on CLOCK pin
-     */
-    caliperInitInterrupts();
+    decoder_init();
 
+#if defined(CONFIG_CALIPER_CAPTURE_EDGE)
     /*
-     *  Initialize DATA pin
+     *  CLOCK pins belong to the edge engine (GPIOTE/PPI/TIMER)
      */
-    gpio_pin_configure_dt(&data_spec, (GPIO_PULL_DOWN | GPIO_INPUT));
+    edge_capture_init();
+#endif
+
+#if defined(CONFIG_CALIPER_CAPTURE_GPIO)
+    caliperUnitsInit();
+#endif
+
+    k_work_queue_start(&caliper_deadline_q, caliper_deadline_stack,
+                       K_THREAD_STACK_SIZEOF(caliper_deadline_stack),
+                       CALIPER_THREAD_PRIORITY, NULL);
+
+    for (i=0; i < CALIPER_CHANNELS; i++) {
+
+        ch = &channels[i];
+        ch->index = i;
+
+        k_sem_init(&ch->gpio_sem, 0, 1);
+        k_mutex_init(&ch->arm_mutex);
+        sys_slist_init(&ch->requests);
+        ch->armed = IS_ENABLED(CONFIG_CALIPER_CONTINUOUS);
+#if defined(CONFIG_CALIPER_CAPTURE_GPIO)
+        k_sem_init(&ch->units_sem, 0, 1);
+#endif
+
+#if !defined(CONFIG_CALIPER_CAPTURE_EDGE) && !defined(CONFIG_CALIPER_CAPTURE_SPIS)
+        /*
+         *  Initialize interrupts on CLOCK pin (the edge and SPIS engines
+         *  own its GPIOTE channel)
+         */
+        caliperInitInterrupts(ch);
+#endif
+
+        /*
+         *  Initialize DATA pin
+         */
+        gpio_pin_configure_dt(&ch->data_spec, (GPIO_PULL_DOWN | GPIO_INPUT));
+
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+        /*
+         *  Initialize REQ pin: output, not requesting
+         */
+        gpio_pin_configure_dt(&ch->req_spec, GPIO_OUTPUT_INACTIVE);
+#endif
+
+        k_thread_create(&ch->thread, caliper_stacks[i],
+                        K_THREAD_STACK_SIZEOF(caliper_stacks[i]),
+                        caliperBackend, ch, NULL, NULL,
+                        CALIPER_THREAD_PRIORITY, 0, K_NO_WAIT);
+    }
+
+#if defined(CONFIG_CALIPER_CAPTURE_SPIS)
+    spis_capture_init(caliperSpisStart);
+#endif
 }
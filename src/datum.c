@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  datum.c  -- Tare and datum references
+ *
+ *  The absolute reading is remembered per channel; when a datum slot is
+ *  active, the reading becomes its deviation from that slot's zero.
+ *  Everything downstream (requests, snapshots, tolerance, statistics)
+ *  then sees relative values.
+ *
+ *  Capturing a slot takes the channels' latest absolute readings as the
+ *  zero, in their own standard.  Readings in that standard are exact
+ *  integer differences; in the other standard the zero is converted
+ *  first, exactly (1 inch = 127/5 mm) and rounded once to the nearest
+ *  count.  Slots and the active one are kept in settings ("datum/<n>",
+ *  "datum/active") so they survive a reboot.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "datum.h"
+#include "caliper.h"
+#include "units.h"
+#include "store.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(datum, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define DATUM_SLOTS   CONFIG_CALIPER_DATUM_SLOTS
+
+static datum_slot_t slots [DATUM_SLOTS];
+
+static int active = DATUM_NONE;
+
+/* Latest absolute reading per channel */
+static struct {
+    bool      have;
+    int32_t   value;
+    uint8_t   standard;
+} absolute [CALIPER_CHANNELS];
+
+static struct k_spinlock datum_lock;
+
+/*---------------------------------------------------------------------------*/
+/*  Settings: "datum/active" and "datum/<slot>".                             */
+/*---------------------------------------------------------------------------*/
+static const store_table_t datum_store = {
+    .subtree    = "datum",
+    .scalar     = "active",
+    .value      = &active,
+    .items      = slots,
+    .item_size  = sizeof(slots[0]),
+    .item_count = DATUM_SLOTS,
+};
+
+static int datumSettingsSet(const char * name, size_t len,
+                            settings_read_cb read_cb, void * cb_arg)
+{
+    return store_table_set(&datum_store, name, len, read_cb, cb_arg);
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(datum, "datum", NULL, datumSettingsSet,
+                               NULL, NULL);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int datumSave(int slot)
+{
+    char name [16];
+    datum_slot_t copy;
+    k_spinlock_key_t key = k_spin_lock(&datum_lock);
+
+    copy = slots[slot];
+
+    k_spin_unlock(&datum_lock, key);
+
+    snprintf(name, sizeof(name), "datum/%d", slot);
+
+    return settings_save_one(name, &copy, sizeof(copy));
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Subtract the active datum's zero, if any.  Called with datum_lock held.  */
+/*---------------------------------------------------------------------------*/
+static void datumSubtract(caliper_reading_t * reading)
+{
+    int channel = reading->channel;
+    const datum_slot_t * slot;
+
+    if (active != DATUM_NONE && slots[active].defined) {
+        slot = &slots[active];
+        reading->value -= units_convert(slot->zero[channel],
+                                        slot->standard[channel],
+                                        reading->standard);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Caliper thread, after each good reading: make it relative to the        */
+/*  active datum, if any.                                                    */
+/*---------------------------------------------------------------------------*/
+void datum_apply(caliper_reading_t * reading)
+{
+    int channel = reading->channel;
+    k_spinlock_key_t key = k_spin_lock(&datum_lock);
+
+    absolute[channel].have     = true;
+    absolute[channel].value    = reading->value;
+    absolute[channel].standard = reading->standard;
+
+    datumSubtract(reading);
+
+    k_spin_unlock(&datum_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  As datum_apply, for a copy taken off the chain: the absolute reading     */
+/*  is left as it is.                                                        */
+/*---------------------------------------------------------------------------*/
+void datum_relative(caliper_reading_t * reading)
+{
+    k_spinlock_key_t key = k_spin_lock(&datum_lock);
+
+    datumSubtract(reading);
+
+    k_spin_unlock(&datum_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Latest absolute reading, whatever datum is active.                       */
+/*---------------------------------------------------------------------------*/
+int datum_absolute(int channel, int32_t * value, int * standard)
+{
+    int ret = -ENODATA;
+    k_spinlock_key_t key;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&datum_lock);
+
+    if (absolute[channel].have) {
+        *value    = absolute[channel].value;
+        *standard = absolute[channel].standard;
+        ret = 0;
+    }
+
+    k_spin_unlock(&datum_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Zero slot at the latest absolute readings, name it (NULL keeps the old   */
+/*  name) and make it active.  -ENODATA until every channel has a reading.   */
+/*---------------------------------------------------------------------------*/
+int datum_capture(int slot, const char * name)
+{
+    int ret = 0;
+    k_spinlock_key_t key;
+
+    if (slot < 0 || slot >= DATUM_SLOTS) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&datum_lock);
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        if (!absolute[i].have) {
+            ret = -ENODATA;
+        }
+    }
+    if (ret == 0) {
+        for (int i=0; i < CALIPER_CHANNELS; i++) {
+            slots[slot].zero[i]     = absolute[i].value;
+            slots[slot].standard[i] = absolute[i].standard;
+        }
+        if (name != NULL) {
+            strncpy(slots[slot].name, name, DATUM_NAME_SIZE - 1);
+            slots[slot].name[DATUM_NAME_SIZE - 1] = '\0';
+        }
+        else if (!slots[slot].defined) {
+            snprintf(slots[slot].name, DATUM_NAME_SIZE, "d%d", slot);
+        }
+        slots[slot].defined = true;
+    }
+
+    k_spin_unlock(&datum_lock, key);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = datumSave(slot);
+    if (ret == 0) {
+        ret = datum_select(slot);
+    }
+
+    LOG_INF("%s: slot %d \"%s\"", __func__, slot, slots[slot].name);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Forget slot; if it was active, readings are absolute again.              */
+/*---------------------------------------------------------------------------*/
+int datum_clear(int slot)
+{
+    int ret;
+    k_spinlock_key_t key;
+
+    if (slot < 0 || slot >= DATUM_SLOTS) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&datum_lock);
+    memset(&slots[slot], 0, sizeof(slots[slot]));
+    k_spin_unlock(&datum_lock, key);
+
+    ret = datumSave(slot);
+    if (ret == 0 && active == slot) {
+        ret = datum_select(DATUM_NONE);
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Make slot active, or DATUM_NONE for absolute readings.                   */
+/*---------------------------------------------------------------------------*/
+int datum_select(int slot)
+{
+    k_spinlock_key_t key;
+
+    if (slot != DATUM_NONE &&
+        (slot < 0 || slot >= DATUM_SLOTS || !slots[slot].defined)) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&datum_lock);
+    active = slot;
+    k_spin_unlock(&datum_lock, key);
+
+    return settings_save_one("datum/active", &slot, sizeof(slot));
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int datum_active(void)
+{
+    return active;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Slot by name, or -ENOENT.                                                */
+/*---------------------------------------------------------------------------*/
+int datum_find(const char * name)
+{
+    for (int i=0; i < DATUM_SLOTS; i++) {
+        if (slots[i].defined && strcmp(slots[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -ENOENT;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int datum_get(int slot, datum_slot_t * datum)
+{
+    k_spinlock_key_t key;
+
+    if (slot < 0 || slot >= DATUM_SLOTS) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&datum_lock);
+    *datum = slots[slot];
+    k_spin_unlock(&datum_lock, key);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Load slots from settings.                                                */
+/*---------------------------------------------------------------------------*/
+void datum_init(void)
+{
+    store_table_load(&datum_store);
+
+    if (active != DATUM_NONE &&
+        (active < 0 || active >= DATUM_SLOTS || !slots[active].defined)) {
+        active = DATUM_NONE;
+    }
+
+    LOG_INF("%s: datum %d of %d", __func__, active, DATUM_SLOTS);
+}
@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  decoder.c  -- Caliper protocol decoders
+ *
+ *  Each protocol is a descriptor in decoders[]: frame length, bit period
+ *  window and a decode function (the binary layouts share one function,
+ *  driven by the descriptor).  Decoders not enabled in Kconfig are not
+ *  compiled in.  Each caliper channel has its own protocol, from its
+ *  node's "protocol" property in devicetree, else CONFIG_CALIPER_PROTOCOL;
+ *  "auto" picks the first detectable descriptor matching the edge count
+ *  and bit period of the frames coming in, and re-detects if they stop
+ *  matching.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/timing/timing.h>
+#include <string.h>
+
+#include "decoder.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(decoder, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define HIGH        1
+#define LOW         0
+
+#define DECODER_REDETECT     3      /* mismatched frames before re-detect */
+
+#define BIN48_COUNTS_PER_INCH  20480
+
+static int decodeBinary(const caliper_decoder_t * decoder,
+                        const caliper_frame_t * frame,
+                        int32_t * value, int * standard);
+static int decodeBin48(const caliper_decoder_t * decoder,
+                       const caliper_frame_t * frame,
+                       int32_t * value, int * standard);
+static int decodeBcd6(const caliper_decoder_t * decoder,
+                      const caliper_frame_t * frame,
+                      int32_t * value, int * standard);
+static int decodeDigimatic(const caliper_decoder_t * decoder,
+                           const caliper_frame_t * frame,
+                           int32_t * value, int * standard);
+
+static const caliper_decoder_t decoders [] = {
+#if defined(CONFIG_CALIPER_DECODER_BIN24)
+    /*
+     *  24 bits: 16-bit magnitude, sign at bit 21, units flag on DATA
+     *  after the last clock (the original caliper).
+     */
+    {
+        .name       = "bin24",
+        .decode     = decodeBinary,
+        .bits       = 24,
+        .bit_min_us = 100,
+        .bit_max_us = 1000,
+        .detect     = true,
+        .sample     = 0x0004D2,
+        .value_bits = 16,
+        .sign_bit   = 21,
+        .units_bit  = DECODER_UNITS_AFTER_FRAME,
+        .drop_bits  = 1,      // bit 0: half a count, not displayed
+        .mm_scale   = 10,     // count = 0.01 mm
+        .inch_scale = 50,     // count = 0.0005 inch
+        .reserved_mask  = CONFIG_CALIPER_DECODER_BIN24_RESERVED_MASK,
+        .reserved_value = CONFIG_CALIPER_DECODER_BIN24_RESERVED_VALUE,
+    },
+#endif
+#if defined(CONFIG_CALIPER_DECODER_BIN24_ALT)
+    /*
+     *  24 bits, layout set in Kconfig.  Same edge count and timing as
+     *  bin24, so it can only be selected, never detected.
+     */
+    {
+        .name       = "bin24-alt",
+        .decode     = decodeBinary,
+        .bits       = 24,
+        .bit_min_us = 100,
+        .bit_max_us = 1000,
+        .detect     = false,
+        .sample     = 0x0004D2,
+        .value_bits = CONFIG_CALIPER_DECODER_BIN24_ALT_VALUE_BITS,
+        .sign_bit   = CONFIG_CALIPER_DECODER_BIN24_ALT_SIGN_BIT,
+        .units_bit  = CONFIG_CALIPER_DECODER_BIN24_ALT_UNITS_BIT,
+        .drop_bits  = 1,      // bit 0: half a count, not displayed
+        .mm_scale   = 10,     // count = 0.01 mm
+        .inch_scale = 50,     // count = 0.0005 inch
+    },
+#endif
+#if defined(CONFIG_CALIPER_DECODER_BIN48)
+    /*
+     *  48 bits: absolute then relative position, each a 24-bit two's
+     *  complement count of 1/20480 inch.  Fast clock.
+     */
+    {
+        .name       = "bin48",
+        .decode     = decodeBin48,
+        .bits       = 48,
+        .bit_min_us = 2,
+        .bit_max_us = 50,
+        .detect     = true,
+        .sample     = (0x001400ULL << 24) | 0x001400,
+    },
+#endif
+#if defined(CONFIG_CALIPER_DECODER_BCD6)
+    /*
+     *  28 bits: six BCD digits, least significant first, then a flags
+     *  nibble (bit 0 minus, bit 1 inch).
+     */
+    {
+        .name       = "bcd6",
+        .decode     = decodeBcd6,
+        .bits       = 28,
+        .bit_min_us = 100,
+        .bit_max_us = 1000,
+        .detect     = true,
+        .sample     = 0x0012345,
+        .reserved_mask  = 0xC000000,   // flags nibble, bits 2-3
+        .reserved_value = 0,
+    },
+#endif
+#if defined(CONFIG_CALIPER_DECODER_DIGIMATIC)
+    /*
+     *  52 bits, 13 nibbles each LSB first: four 0xF, sign (0 or 8),
+     *  six BCD digits most significant first, decimal point position,
+     *  units (0 mm, 1 inch).  Sent only on REQ, so never detected.
+     */
+    {
+        .name       = "digimatic",
+        .decode     = decodeDigimatic,
+        .bits       = 52,
+        .bit_min_us = 50,
+        .bit_max_us = 2000,
+        .detect     = false,
+        .sample     = 0x025432100FFFFULL,
+    },
+#endif
+};
+
+static decoder_stats_t decoder_stats [ARRAY_SIZE(decoders)];
+
+typedef struct {
+    const caliper_decoder_t * active;
+    bool  auto_detect;
+    int   mismatches;
+    uint32_t bit_us;      // measured bit period, averaged; 0 if unknown
+} decoder_channel_t;
+
+static decoder_channel_t channels [CALIPER_CHANNELS];
+
+#define DECODER_PROTOCOL(node)  DT_PROP_OR(node, protocol, CONFIG_CALIPER_PROTOCOL),
+
+static const char * const protocols [] = {
+    DT_FOREACH_STATUS_OKAY(caliper, DECODER_PROTOCOL)
+};
+
+/*---------------------------------------------------------------------------*/
+/*  Table-driven binary layout: magnitude, sign bit, units bit.              */
+/*---------------------------------------------------------------------------*/
+static int decodeBinary(const caliper_decoder_t * decoder,
+                        const caliper_frame_t * frame,
+                        int32_t * value, int * standard)
+{
+    int32_t raw   = (int32_t) (frame->data & BIT_MASK(decoder->value_bits));
+    int     units = frame->units;
+
+    if (decoder->units_bit != DECODER_UNITS_AFTER_FRAME) {
+        units = (frame->data >> decoder->units_bit) & 1;
+    }
+    if (units < 0) {
+        return -ENODATA;
+    }
+
+    /*
+     *  The magnitude is in half counts: the bits below the count carry
+     *  nothing the display shows.
+     */
+    raw >>= decoder->drop_bits;
+
+    /*
+     *  For mm-mode, the units flag is high; for in-mode it is low.
+     *  Scaled up to reading counts, exactly.
+     */
+    if (units == HIGH) {
+        *standard = CALIPER_STANDARD_INCH;
+        raw *= decoder->inch_scale;
+    }
+    else {
+        *standard = CALIPER_STANDARD_MM;
+        raw *= decoder->mm_scale;
+    }
+
+    if (frame->data & BIT64(decoder->sign_bit)) {
+        raw = -raw;
+    }
+
+    *value = raw;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  48-bit absolute/relative: report the relative (displayed) position.      */
+/*---------------------------------------------------------------------------*/
+static int decodeBin48(const caliper_decoder_t * decoder,
+                       const caliper_frame_t * frame,
+                       int32_t * value, int * standard)
+{
+    uint32_t word   = (uint32_t) (frame->data >> 24) & BIT_MASK(24);
+    int32_t  counts = ((int32_t) (word << 8)) >> 8;
+    int64_t  scaled;
+
+    ARG_UNUSED(decoder);
+
+    /*
+     *  Units are not sent; convert to 0.001 mm, rounded.
+     *  25400 / 20480 = 635 / 512
+     */
+    scaled = (int64_t) counts * 635;
+    scaled += (scaled < 0) ? -256 : 256;
+
+    *value    = (int32_t) (scaled / 512);
+    *standard = CALIPER_STANDARD_MM;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Six BCD digits plus flags nibble.                                        */
+/*---------------------------------------------------------------------------*/
+static int decodeBcd6(const caliper_decoder_t * decoder,
+                      const caliper_frame_t * frame,
+                      int32_t * value, int * standard)
+{
+    uint32_t flags = (uint32_t) (frame->data >> 24) & 0xF;
+    int32_t  result = 0;
+    int      i;
+
+    ARG_UNUSED(decoder);
+
+    for (i=5; i >= 0; i--) {
+        uint32_t digit = (uint32_t) (frame->data >> (i * 4)) & 0xF;
+
+        if (digit > 9) {
+            return -EBADMSG;
+        }
+        result = (result * 10) + digit;
+    }
+
+    /*
+     *  Digits are 0.01 mm or 0.001 inch.
+     */
+    if (flags & BIT(1)) {
+        *standard = CALIPER_STANDARD_INCH;
+        result   *= 100;
+    }
+    else {
+        *standard = CALIPER_STANDARD_MM;
+        result   *= 10;
+    }
+    *value = (flags & BIT(0)) ? -result : result;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Mitutoyo Digimatic: 13 nibbles with sign, digits, decimal point, units.  */
+/*---------------------------------------------------------------------------*/
+static int decodeDigimatic(const caliper_decoder_t * decoder,
+                           const caliper_frame_t * frame,
+                           int32_t * value, int * standard)
+{
+    uint32_t nibble [13];
+    int32_t  result = 0;
+    int      decimals;
+    int      i;
+
+    ARG_UNUSED(decoder);
+
+    for (i=0; i < ARRAY_SIZE(nibble); i++) {
+        nibble[i] = (uint32_t) (frame->data >> (i * 4)) & 0xF;
+    }
+
+    /*
+     *  Header, sign, digits and decimal point must all make sense.
+     */
+    for (i=0; i < 4; i++) {
+        if (nibble[i] != 0xF) {
+            return -EBADMSG;
+        }
+    }
+    if ((nibble[4] != 0 && nibble[4] != 8) || nibble[11] > 5 || nibble[12] > 1) {
+        return -EBADMSG;
+    }
+
+    for (i=5; i <= 10; i++) {
+        if (nibble[i] > 9) {
+            return -EBADMSG;
+        }
+        result = (result * 10) + nibble[i];
+    }
+
+    /*
+     *  Rescale from the gauge's decimal point to reading counts.
+     */
+    *standard = (nibble[12]) ? CALIPER_STANDARD_INCH : CALIPER_STANDARD_MM;
+    decimals  = (*standard == CALIPER_STANDARD_MM) ? CALIPER_MM_DECIMALS :
+                                                     CALIPER_INCH_DECIMALS;
+
+    for (i=nibble[11]; i < decimals; i++) {
+        result *= 10;
+    }
+    for (i=decimals; i < nibble[11]; i++) {
+        result = (result + 5) / 10;
+    }
+
+    *value = (nibble[4]) ? -result : result;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Match a frame's edge count and bit period against the table.             */
+/*---------------------------------------------------------------------------*/
+static const caliper_decoder_t * decoderDetect(const caliper_frame_t * frame)
+{
+    uint32_t bit_us = 0;
+    int i;
+
+    if (frame->duration != 0 && frame->bits > 1) {
+        bit_us = frame->duration / (frame->bits - 1);
+    }
+
+    for (i=0; i < ARRAY_SIZE(decoders); i++) {
+
+        const caliper_decoder_t * decoder = &decoders[i];
+
+        if (!decoder->detect || frame->bits != decoder->bits) {
+            continue;
+        }
+        if (bit_us != 0 && (bit_us < decoder->bit_min_us ||
+                            bit_us > decoder->bit_max_us)) {
+            continue;
+        }
+
+        LOG_INF("detected %s: %u bits, %u us/bit",
+                decoder->name, frame->bits, bit_us);
+        return decoder;
+    }
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Decode one frame with the active protocol; detect it first if needed.    */
+/*---------------------------------------------------------------------------*/
+int decoder_decode(int channel, const caliper_frame_t * frame,
+                   int32_t * value, int * standard)
+{
+    decoder_channel_t * ch = &channels[channel];
+    const caliper_decoder_t * decoder = ch->active;
+    decoder_stats_t * stats;
+    int ret;
+
+    if (decoder == NULL) {
+        decoder = decoderDetect(frame);
+        if (decoder == NULL) {
+            return -ENOTSUP;
+        }
+        ch->active = decoder;
+        ch->mismatches = 0;
+        ch->bit_us = 0;
+    }
+
+    stats = &decoder_stats[decoder - decoders];
+
+    if (frame->bits != decoder->bits) {
+        stats->errors++;
+
+        /*
+         *  Caliper swapped for another brand?
+         */
+        if (ch->auto_detect && ++ch->mismatches >= DECODER_REDETECT) {
+            LOG_INF("%d: %s: %u bit frames, re-detecting",
+                    channel, decoder->name, frame->bits);
+            ch->active = NULL;
+        }
+        return -EBADMSG;
+    }
+    ch->mismatches = 0;
+
+#if defined(CONFIG_CALIPER_VALIDATE)
+    if ((frame->data & decoder->reserved_mask) != decoder->reserved_value) {
+        stats->errors++;
+        return -EILSEQ;
+    }
+#endif
+
+    /*
+     *  Track this caliper's bit period (1/4 weight per frame); the
+     *  engines time the out-of-frame units flag from it.
+     */
+    if (frame->duration != 0 && frame->bits > 1) {
+        uint32_t bit_us = frame->duration / (frame->bits - 1);
+
+        ch->bit_us = (ch->bit_us == 0) ? bit_us
+                                       : (3 * ch->bit_us + bit_us) / 4;
+    }
+
+#if defined(CONFIG_CALIPER_DECODER_BENCHMARK)
+    timing_t start = timing_counter_get();
+
+    ret = decoder->decode(decoder, frame, value, standard);
+
+    timing_t end = timing_counter_get();
+
+    stats->last_ns = (uint32_t) timing_cycles_to_ns(
+                                    timing_cycles_get(&start, &end));
+    stats->max_ns  = MAX(stats->max_ns, stats->last_ns);
+#else
+    ret = decoder->decode(decoder, frame, value, standard);
+#endif
+
+    stats->decodes++;
+    if (ret != 0) {
+        stats->errors++;
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Clock edges per frame of the active protocol; 0 while detecting.        */
+/*---------------------------------------------------------------------------*/
+int decoder_frame_bits(int channel)
+{
+    const caliper_decoder_t * decoder = channels[channel].active;
+
+    return (decoder) ? decoder->bits : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Measured bit period of the channel's caliper; 0 until a frame decodes.   */
+/*---------------------------------------------------------------------------*/
+uint32_t decoder_bit_period_us(int channel)
+{
+    return channels[channel].bit_us;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  When to sample the out-of-frame units flag, after the last clock edge.   */
+/*  CALIPER_UNITS_DELAY_PERCENT of the bit period, the fixed                 */
+/*  CALIPER_UNITS_DELAY_US until a bit period has been measured.             */
+/*---------------------------------------------------------------------------*/
+uint32_t decoder_units_delay_us(int channel)
+{
+    uint32_t bit_us = channels[channel].bit_us;
+
+    if (bit_us == 0) {
+        return CONFIG_CALIPER_UNITS_DELAY_US;
+    }
+    return (bit_us * CONFIG_CALIPER_UNITS_DELAY_PERCENT) / 100;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Select a protocol by name, or "auto".                                    */
+/*---------------------------------------------------------------------------*/
+int decoder_select(int channel, const char * name)
+{
+    decoder_channel_t * ch = &channels[channel];
+    int i;
+
+    if (strcmp(name, "auto") == 0) {
+        ch->auto_detect = true;
+        ch->active = NULL;
+        ch->bit_us = 0;
+        return 0;
+    }
+
+    for (i=0; i < ARRAY_SIZE(decoders); i++) {
+        if (strcmp(name, decoders[i].name) == 0) {
+            ch->auto_detect = false;
+            ch->active = &decoders[i];
+            ch->bit_us = 0;
+            return 0;
+        }
+    }
+    return -ENOENT;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+const char * decoder_name(int channel)
+{
+    const caliper_decoder_t * decoder = channels[channel].active;
+
+    if (decoder == NULL) {
+        return "auto (detecting)";
+    }
+    return decoder->name;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int decoder_count(void)
+{
+    return ARRAY_SIZE(decoders);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+const caliper_decoder_t * decoder_get(int index, decoder_stats_t * stats)
+{
+    if (index < 0 || index >= ARRAY_SIZE(decoders)) {
+        return NULL;
+    }
+    if (stats) {
+        *stats = decoder_stats[index];
+    }
+    return &decoders[index];
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Decode the descriptor's sample frame 'rounds' times; average ns/decode.  */
+/*---------------------------------------------------------------------------*/
+int decoder_benchmark(int index, int rounds, uint32_t * ns)
+{
+    const caliper_decoder_t * decoder;
+    caliper_frame_t frame;
+    int32_t  value;
+    int      standard;
+    uint32_t start;
+    uint32_t cycles;
+    int      ret = 0;
+    int      i;
+
+    decoder = decoder_get(index, NULL);
+    if (decoder == NULL || rounds <= 0) {
+        return -EINVAL;
+    }
+
+    frame.data     = decoder->sample;
+    frame.bits     = decoder->bits;
+    frame.units    = LOW;
+    frame.duration = 0;
+
+    start = k_cycle_get_32();
+
+    for (i=0; i < rounds && ret == 0; i++) {
+        ret = decoder->decode(decoder, &frame, &value, &standard);
+    }
+
+    cycles = k_cycle_get_32() - start;
+
+    *ns = (uint32_t) (k_cyc_to_ns_floor64(cycles) / rounds);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void decoder_init(void)
+{
+    int i;
+
+#if defined(CONFIG_CALIPER_DECODER_BENCHMARK)
+    timing_init();
+    timing_start();
+#endif
+
+    for (i=0; i < CALIPER_CHANNELS; i++) {
+        if (decoder_select(i, protocols[i]) != 0) {
+            LOG_ERR("Error: protocol \"%s\" not built in, using auto",
+                    protocols[i]);
+            decoder_select(i, "auto");
+        }
+        LOG_INF("%s: channel %d protocol %s", __func__, i, protocols[i]);
+    }
+}
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  edge_capture.c  -- Caliper clock-edge timestamp engine
+ *
+ *  GPIOTE raises an event on every falling CLOCK edge; PPI routes it to
+ *  a TIMER CAPTURE task, so each edge is timestamped in hardware no matter
+ *  how late its interrupt is serviced.  The edge interrupt only samples
+ *  DATA and moves the channel's timeout compare; finding the units flag,
+ *  the interframe gap and "caliper off" are all TIMER compares, so nothing
+ *  here ever spins on a pin.
+ *
+ *  Every caliper channel has its own GPIOTE/PPI channel and a pair of
+ *  TIMER3 compare registers (1 MHz, 32 bits, free running):
+ *      CC[2n]    captured by PPI on each falling CLOCK edge of channel n
+ *      CC[2n+1]  timeout, stepped through the stages of the frame end:
+ *                  last edge + units -> sample units flag (last bit only,
+ *                                       every bit while protocol unknown;
+ *                                       delay scaled to this frame's
+ *                                       measured bit period)
+ *                  last edge + gap   -> end of frame / interframe gap
+ *                                       (shortened in fast mode)
+ *                  last edge + off   -> caliper powered off
+ *
+ *  TIMER0/1 belong to the BLE controller, hence TIMER3: with six CC
+ *  registers it serves up to three calipers, captured concurrently.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_gpio.h>
+
+#include "edge_capture.h"
+#include "caliper_gpio.h"
+#include "sigmon.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(edge_capture, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define EDGE_FRAME_MAX_BITS    64       /* frame is a uint64_t */
+
+#define EDGE_OFF_US            500000   /* same as framer_active_timer */
+
+#define EDGE_RING_SIZE         64       /* power of two */
+
+#define EDGE_MSGQ_DEPTH        4
+
+#define EDGE_TIMER_NODE   DT_NODELABEL(timer3)
+#define EDGE_GPIOTE_NODE  DT_NODELABEL(gpiote)
+
+BUILD_ASSERT(CALIPER_CHANNELS <= 3, "TIMER3 has CC registers for 3 calipers");
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(0);
+static const nrfx_timer_t  timer  = NRFX_TIMER_INSTANCE(3);
+
+typedef enum {
+    STAGE_IDLE = 0,       // caliper off, no compare pending
+    STAGE_UNITS,          // waiting to sample units flag
+    STAGE_GAP,            // waiting for the interframe gap
+    STAGE_OFF,            // in gap, waiting to declare caliper off
+} edge_stage_t;
+
+typedef struct {
+    uint32_t      clock_psel;
+    uint32_t      data_psel;
+    nrf_timer_cc_channel_t  cc_edge;
+    nrf_timer_cc_channel_t  cc_timeout;
+
+    struct k_msgq frame_msgq;
+    char          frame_buffer [EDGE_MSGQ_DEPTH * sizeof(edge_frame_t)]
+                                                        __aligned(4);
+    struct k_sem  gap_sem;
+
+    /*
+     *  Frame assembly state, owned by the edge/timer interrupts.
+     */
+    edge_frame_t  current;
+    uint32_t      last_edge;
+    edge_stage_t  stage;
+
+    /*
+     *  Frame length of the active protocol; 0 while it is being detected.
+     */
+    uint8_t       frame_bits;
+
+    /*
+     *  CLOCK idle this long ends a frame; see framer_gap_us().
+     */
+    uint32_t      gap_us;
+
+    /*
+     *  Raw falling-edge timestamps, most recent at edge_head-1.
+     */
+    uint32_t      edge_ring [EDGE_RING_SIZE];
+    uint32_t      edge_head;
+} edge_channel_t;
+
+#define EDGE_CHANNEL_INIT(node)                                               \
+    {                                                                         \
+        .clock_psel = NRF_DT_GPIOS_TO_PSEL(CHANNEL_CLOCK_NODE(node), gpios),  \
+        .data_psel  = NRF_DT_GPIOS_TO_PSEL(CHANNEL_DATA_NODE(node), gpios),   \
+    },
+
+static edge_channel_t channels [] = {
+    DT_FOREACH_STATUS_OKAY(caliper, EDGE_CHANNEL_INIT)
+};
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void edgeTimeout(edge_channel_t * ch, edge_stage_t stage, uint32_t delay)
+{
+    ch->stage = stage;
+    nrfx_timer_compare(&timer, ch->cc_timeout, ch->last_edge + delay, true);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Units flag delay, from the bit period of the frame being received.       */
+/*---------------------------------------------------------------------------*/
+static uint32_t edgeUnitsDelay(edge_channel_t * ch)
+{
+    uint32_t bit_us;
+
+    if (ch->current.bits < 2) {
+        return CONFIG_CALIPER_UNITS_DELAY_US;
+    }
+
+    bit_us = (ch->current.end - ch->current.start) / (ch->current.bits - 1);
+
+    return (bit_us * CONFIG_CALIPER_UNITS_DELAY_PERCENT) / 100;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Falling CLOCK edge: timestamp already latched into CC[2n] by PPI.        */
+/*---------------------------------------------------------------------------*/
+static void edgeClockHandler(nrfx_gpiote_pin_t pin,
+                             nrfx_gpiote_trigger_t trigger,
+                             void * context)
+{
+    edge_channel_t * ch = context;
+    uint32_t now = nrfx_timer_capture_get(&timer, ch->cc_edge);
+    int      bit = nrf_gpio_pin_read(ch->data_psel);
+
+    ch->edge_ring[ch->edge_head++ & (EDGE_RING_SIZE - 1)] = now;
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+    /*
+     *  Only falling edges are seen: bit periods and gaps, no widths.
+     */
+    if (ch->stage == STAGE_UNITS || ch->stage == STAGE_GAP) {
+        sigmon_width(ch - channels, SIGMON_PERIOD, now - ch->last_edge);
+    }
+    else if (ch->stage == STAGE_OFF) {
+        sigmon_width(ch - channels, SIGMON_GAP, now - ch->last_edge);
+    }
+#endif
+
+    /*
+     *  First edge after a gap starts a new frame.
+     */
+    if (ch->stage != STAGE_UNITS && ch->stage != STAGE_GAP) {
+        ch->current.frame = 0;
+        ch->current.bits  = 0;
+        ch->current.start = now;
+    }
+
+    if (ch->current.bits < EDGE_FRAME_MAX_BITS) {
+        ch->current.frame |= ((uint64_t) bit << ch->current.bits);
+    }
+    if (ch->current.bits <= EDGE_FRAME_MAX_BITS) {
+        ch->current.bits++;
+    }
+    ch->current.end = now;
+    ch->last_edge   = now;
+
+    /*
+     *  Units flag follows the last bit only; don't take the
+     *  compare interrupt between ordinary bits, unless the frame
+     *  length is not known yet.
+     */
+    if (ch->frame_bits == 0 || ch->current.bits == ch->frame_bits) {
+        edgeTimeout(ch, STAGE_UNITS, edgeUnitsDelay(ch));
+    }
+    else {
+        edgeTimeout(ch, STAGE_GAP, ch->gap_us);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void edgeTimerHandler(nrf_timer_event_t event, void * context)
+{
+    edge_channel_t * ch = NULL;
+    int i;
+
+    for (i=0; i < ARRAY_SIZE(channels); i++) {
+        if (event == nrf_timer_compare_event_get(channels[i].cc_timeout)) {
+            ch = &channels[i];
+        }
+    }
+    if (ch == NULL) {
+        return;
+    }
+
+    switch (ch->stage) {
+
+        case STAGE_UNITS:
+            ch->current.units = nrf_gpio_pin_read(ch->data_psel);
+            edgeTimeout(ch, STAGE_GAP, ch->gap_us);
+            break;
+
+        case STAGE_GAP:
+            /*
+             *  Only whole frames are passed on; a frame entered
+             *  mid-way, or a glitched one, is just dropped.  While
+             *  detecting, anything that fits goes to the decoder.
+             */
+            if ((ch->frame_bits == 0 &&
+                 ch->current.bits <= EDGE_FRAME_MAX_BITS) ||
+                ch->current.bits == ch->frame_bits) {
+                k_msgq_put(&ch->frame_msgq, &ch->current, K_NO_WAIT);
+            }
+            k_sem_give(&ch->gap_sem);
+            edgeTimeout(ch, STAGE_OFF, EDGE_OFF_US);
+            break;
+
+        case STAGE_OFF:
+            nrfx_timer_compare_int_disable(&timer, BIT(ch->cc_timeout));
+            ch->stage = STAGE_IDLE;
+            LOG_DBG("Caliper %d is \"OFF\"", (int) (ch - channels));
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Wait for the interframe gap; returns -EAGAIN if caliper stays silent.    */
+/*---------------------------------------------------------------------------*/
+int edge_capture_wait_gap(int channel, k_timeout_t timeout)
+{
+    edge_channel_t * ch = &channels[channel];
+
+    k_sem_reset(&ch->gap_sem);
+
+    /*
+     *  Already sitting in a gap with the caliper still clocking?
+     */
+    if (ch->stage == STAGE_OFF) {
+        return 0;
+    }
+
+    if (k_sem_take(&ch->gap_sem, timeout) != 0) {
+        return -EAGAIN;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int edge_capture_get_frame(int channel, edge_frame_t * frame,
+                           k_timeout_t timeout)
+{
+    return k_msgq_get(&channels[channel].frame_msgq, frame, timeout);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Frame length to expect; 0 passes every frame (protocol detection).       */
+/*---------------------------------------------------------------------------*/
+void edge_capture_set_frame_bits(int channel, int bits)
+{
+    channels[channel].frame_bits = bits;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Interframe gap threshold; CALIPER_GAP_US until the rate is known.        */
+/*---------------------------------------------------------------------------*/
+void edge_capture_set_gap_us(int channel, uint32_t gap_us)
+{
+    channels[channel].gap_us = gap_us;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Discard frames completed before the caller's request.                    */
+/*---------------------------------------------------------------------------*/
+void edge_capture_flush(int channel)
+{
+    k_msgq_purge(&channels[channel].frame_msgq);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Copy up to count most recent edge timestamps, newest first.              */
+/*---------------------------------------------------------------------------*/
+int edge_capture_get_edges(int channel, uint32_t * edges, int count)
+{
+    edge_channel_t * ch = &channels[channel];
+    uint32_t head = ch->edge_head;
+    int i;
+
+    count = MIN(count, MIN(head, EDGE_RING_SIZE));
+
+    for (i=0; i < count; i++) {
+        edges[i] = ch->edge_ring[(head - 1 - i) & (EDGE_RING_SIZE - 1)];
+    }
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  GPIOTE + PPI for one channel's CLOCK pin.                                */
+/*---------------------------------------------------------------------------*/
+static int edgeChannelInit(edge_channel_t * ch, int index)
+{
+    nrfx_err_t err;
+    uint8_t    in_channel;
+    uint8_t    ppi_channel;
+
+    static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_PULLDOWN;
+
+    ch->cc_edge    = (nrf_timer_cc_channel_t) (index * 2);
+    ch->cc_timeout = (nrf_timer_cc_channel_t) (index * 2 + 1);
+    ch->stage      = STAGE_IDLE;
+    ch->gap_us     = CONFIG_CALIPER_GAP_US;
+
+    k_msgq_init(&ch->frame_msgq, ch->frame_buffer,
+                sizeof(edge_frame_t), EDGE_MSGQ_DEPTH);
+    k_sem_init(&ch->gap_sem, 0, 1);
+
+    /*
+     *  GPIOTE: event + interrupt on falling CLOCK edge.
+     */
+    err = nrfx_gpiote_channel_alloc(&gpiote, &in_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no GPIOTE channel", err);
+        return -ENODEV;
+    }
+
+    nrfx_gpiote_trigger_config_t trigger_config = {
+        .trigger      = NRFX_GPIOTE_TRIGGER_HITOLO,
+        .p_in_channel = &in_channel,
+    };
+    nrfx_gpiote_handler_config_t handler_config = {
+        .handler      = edgeClockHandler,
+        .p_context    = ch,
+    };
+    nrfx_gpiote_input_pin_config_t input_config = {
+        .p_pull_config    = &pull,
+        .p_trigger_config = &trigger_config,
+        .p_handler_config = &handler_config,
+    };
+
+    err = nrfx_gpiote_input_configure(&gpiote, ch->clock_psel, &input_config);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: failed to configure clock %d", err, index);
+        return -EIO;
+    }
+
+    /*
+     *  PPI: CLOCK edge event -> TIMER CAPTURE[2n] task.
+     */
+    err = nrfx_gppi_channel_alloc(&ppi_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no PPI channel", err);
+        return -ENODEV;
+    }
+
+    nrfx_gppi_channel_endpoints_setup(ppi_channel,
+        nrfx_gpiote_in_event_address_get(&gpiote, ch->clock_psel),
+        nrfx_timer_capture_task_address_get(&timer, ch->cc_edge));
+
+    nrfx_gppi_channels_enable(BIT(ppi_channel));
+
+    nrfx_gpiote_trigger_enable(&gpiote, ch->clock_psel, true);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void edge_capture_init(void)
+{
+    nrfx_err_t err;
+    int i;
+
+    LOG_INF("%s", __func__);
+
+    /*
+     *  TIMER: 1 MHz free-running timestamp base.
+     */
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+    IRQ_CONNECT(DT_IRQN(EDGE_TIMER_NODE), DT_IRQ(EDGE_GPIOTE_NODE, priority),
+                nrfx_isr, nrfx_timer_3_irq_handler, 0);
+
+    err = nrfx_timer_init(&timer, &timer_cfg, edgeTimerHandler);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: timer init failed", err);
+        return;
+    }
+
+    nrfx_timer_enable(&timer);
+
+    for (i=0; i < ARRAY_SIZE(channels); i++) {
+        if (edgeChannelInit(&channels[i], i) != 0) {
+            return;
+        }
+    }
+
+    LOG_INF("Edge capture on %d channel(s)", (int) ARRAY_SIZE(channels));
+}
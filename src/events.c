@@ -17,6 +17,18 @@
 #include "ble_base.h"
 #include "battery.h"
 #include "tones.h"
+#include "readings.h"
+#include "caliper_gpio.h"
+#include "activity.h"
+#include "phase.h"
+#include "autocap.h"
+#include "output.h"
+#include "stats.h"
+#include "filter.h"
+#include "tolerance.h"
+#include "burst.h"
+#include "session.h"
+#include "peak.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(events, LOG_LEVEL_INF);
@@ -25,45 +37,162 @@ LOG_MODULE_REGISTER(events, LOG_LEVEL_INF);
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
-static char string[16];
+/* Keystrokes for one snapshot, all channels. */
+static keyboard_key_t keys[CONFIG_CALIPER_OUTPUT_MAX_KEYS];
 
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  Render every channel's reading through the output template and type it.  */
+/*  quiet: a tone has confirmed the capture already, so no completion chirp. */
 /*---------------------------------------------------------------------------*/
-void events_build_string(short value, int standard)
+static void eventsSend(const int32_t * values, const int * standards,
+                       int count, bool quiet)
 {
-    float value_float = ((float) value);
-    char * line_end;
-
-    memset(&string, 0, sizeof(string));
-
-    if (standard == CALIPER_STANDARD_MM)
-        value_float /= 100.0F;
-    else
-        value_float /= 1000.0F;
-
-    snprintf(string, sizeof(string), "%.2f", (double)value_float);
-
-    if (app_uicr_get_standard() == INCLUDE) {
-        switch (standard) {
-            default:
-            case CALIPER_STANDARD_MM:
-                strncat(string, " mm", sizeof(string)-sizeof(" mm"));
-                break;
-            case CALIPER_STANDARD_INCH:
-                strncat(string, " inch", sizeof(string)-sizeof(" inch")-1);             
-                break;
+    output_reading_t reading;
+    caliper_latest_t latest;
+    int length = 0;
+    int ret;
+
+    for (int i=0; i < count; i++) {
+
+        reading.value     = values[i];
+        reading.standard  = standards[i];
+        reading.channel   = i;
+        reading.last      = (i == count - 1);
+        reading.seq       = 0;
+        reading.timestamp = 0;
+
+        /*
+         *  The value just read is the one published last.
+         */
+        if (caliper_latest(i, &latest, NULL) == 0 && 
+            latest.value == values[i]) {
+            reading.seq       = latest.seq;
+            reading.timestamp = latest.timestamp;
         }
+
+        ret = output_render(&reading, &keys[length], ARRAY_SIZE(keys) - length);
+        if (ret < 0) {
+            LOG_WRN("%s: output truncated (%d)", __func__, ret);
+            break;
+        }
+        length += ret;
     }
 
-    switch (app_uicr_get_line_end()) { 
+    LOG_INF("%s: %d keys", __func__, length);
+
+    keyboard_send_keys(keys, length, quiet);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A captured reading, every channel: check it, count it, then type it.    */
+/*---------------------------------------------------------------------------*/
+static void eventsCapture(const int32_t * values, const int * standards)
+{
+    bool confirmed = false;
+
+#if defined(CONFIG_CALIPER_TOLERANCE)
+    /*
+     *  Go/no-go on channel 0, before anything is typed.
+     */
+    switch (tolerance_capture(values[0], standards[0])) {
+        case TOLERANCE_PASS:
+            buzzer_play(&tolerance_pass_sound);
+            confirmed = true;
+            break;
+        case TOLERANCE_LOW:
+            LOG_WRN("%s: under tolerance", __func__);
+            buzzer_play(&tolerance_low_sound);
+            confirmed = true;
+            break;
+        case TOLERANCE_HIGH:
+            LOG_WRN("%s: over tolerance", __func__);
+            buzzer_play(&tolerance_high_sound);
+            confirmed = true;
+            break;
         default:
-        case ASCIIZ:  line_end = "";    break;
-        case NEWLINE: line_end = "\n";  break;
+            break;
+    }
+#endif
+
+#if defined(CONFIG_CALIPER_STATS)
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        stats_reading(i, values[i], standards[i]);
+    }
+
+    if (stats_summary_only()) {
+        LOG_INF("%s: summary only, not typed", __func__);
+        if (!confirmed) {
+            buzzer_play(&send_completed_sound);
+        }
+        return;
+    }
+#endif
+
+#if defined(CONFIG_CALIPER_SESSION)
+    if (session_enabled()) {
+        if (session_put(values, standards, CALIPER_CHANNELS) != 0) {
+            LOG_WRN("%s: session full, not stored", __func__);
+            buzzer_play(&error_sound);
+        }
+        else if (!confirmed) {
+            buzzer_play(&send_completed_sound);
+        }
+        return;
+    }
+#endif
+
+    eventsSend(values, standards, CALIPER_CHANNELS, confirmed);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Captures are typed straight away, so need a connection; unless they     */
+/*  are only being stored for later.                                         */
+/*---------------------------------------------------------------------------*/
+static bool eventsLinkDown(void)
+{
+#if defined(CONFIG_CALIPER_SESSION)
+    if (session_enabled()) {
+        return false;
+    }
+#endif
+    return (is_bt_connected() == false);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Continuous mode: use the published readings if every channel has one     */
+/*  no older than a frame period (averaged, if so configured).               */
+/*---------------------------------------------------------------------------*/
+static bool eventsFromLatest(int32_t * values, int * standards)
+{
+    caliper_latest_t latest;
+    uint32_t period;
+    uint32_t age;
+    int i;
+
+    if (!IS_ENABLED(CONFIG_CALIPER_CONTINUOUS)) {
+        return false;
     }
-    strncat(string, line_end, strlen(line_end));
 
-    LOG_INF("string: %s", string);
+    for (i=0; i < CALIPER_CHANNELS; i++) {
+        period = readings_frame_period_us(i);
+        if (caliper_latest(i, &latest, NULL) != 0 || period == 0) {
+            return false;
+        }
+        age = k_ticks_to_us_floor32(k_uptime_ticks() - latest.timestamp);
+        if (age > period) {
+            return false;
+        }
+        values[i]    = latest.value;
+        standards[i] = latest.standard;
+
+#if defined(CONFIG_CALIPER_FILTER)
+        if (filter_average_enabled() &&
+            filter_average(i, &values[i], &standards[i]) != 0) {
+            LOG_INF("%s: %d not settled, not averaged", __func__, i);
+        }
+#endif
+    }
+    return true;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -72,48 +201,155 @@ void events_build_string(short value, int standard)
 static void events_snapshot(buttons_id_t btn_id)
 {
     int   ret;
-    short value;
-    int   standard;
+    int32_t values [CALIPER_CHANNELS];
+    int   standards [CALIPER_CHANNELS];
 
     (void) btn_id;   // unused
 
     LOG_INF("%s: Snapshot", __func__);
 
+#if defined(CONFIG_CALIPER_PEAK)
     /*
-     *  Search for start of next frame.
+     *  Holding extremes: SNAPSHOT ends the hold, which captures them.
      */
-    framer_find_interframe_gap();
+    if (peak_armed()) {
+        if (peak_disarm() != 0) {
+            LOG_WRN("%s: nothing held", __func__);
+            buzzer_play(&error_sound);
+        }
+        return;
+    }
+#endif
 
     /*
-     *  Caliper must be powered on and a BLE connection established.
+     *  Continuous mode: a reading younger than one frame period is as
+     *  good as the next frame, and it is already here.
      */
-    if (is_caliper_on() == CALIPER_POWER_OFF) {
+    if (eventsFromLatest(values, standards)) {
+
+        if (eventsLinkDown()) {
+            LOG_WRN("Bluetooth not connected");
+            buzzer_play(&ble_not_connected_sound);
+            return;
+        }
+
+        LOG_INF("%s: from latest", __func__);
+
+        eventsCapture(values, standards);
+        return;
+    }
+
+    for (int tries = 0; ; tries++) {
+
+        /*
+         *  Search for start of next frame (or, when phase locked, 
+         *  sleep until just before it).
+         */
+        framer_find_interframe_gap();
+
+        /*
+         *  Caliper must be powered on and a BLE connection established.
+         */
+        if (is_caliper_on() == CALIPER_POWER_OFF) {
+            LOG_WRN("Caliper is off");
+            buzzer_play(&caliper_off_sound);
+            return;
+        }
+        if (eventsLinkDown()) {
+            LOG_WRN("Bluetooth not connected");
+            buzzer_play(&ble_not_connected_sound);
+            return;
+        }
+
+        /*
+         *  Prerequisites are good, so read every channel from the same
+         *  frame period.
+         *  -EAGAIN: frame was not where predicted; lock dropped, so
+         *  the retry goes through the gap search.
+         */
+        ret = caliper_read_all(values, standards);
+        if (ret == -EAGAIN && tries == 0) {
+            continue;
+        }
+        break;
+    }
+
+    if (ret == -ETIMEDOUT) {
         LOG_WRN("Caliper is off");
         buzzer_play(&caliper_off_sound);
         return;
     }
-    if (is_bt_connected() == false) {
-        LOG_WRN("Bluetooth not connected");
-        buzzer_play(&ble_not_connected_sound);
+    if (ret != 0) {
+        LOG_ERR("Read failed");
         return;
     }
 
     /*
-     *  Prerequisites are good, so read value.
+     *  Render returned values and send them as HOG input.
      */
-    ret = caliper_read_value(&value, &standard);
-    if (ret != 0) {
-        LOG_ERR("Read failed");
+    eventsCapture(values, standards);
+}
+
+#if defined(CONFIG_CALIPER_AUTO_CAPTURE)
+/*---------------------------------------------------------------------------*/
+/*  Jaws settled: type the settled values, as a snapshot would.              */
+/*---------------------------------------------------------------------------*/
+static void events_auto_capture(const int32_t * values, const int * standards)
+{
+    LOG_INF("%s: Auto-capture", __func__);
+
+    if (eventsLinkDown()) {
+        LOG_WRN("Bluetooth not connected");
+        buzzer_play(&ble_not_connected_sound);
         return;
     }
 
-    /*
-     *  Build string from returned values and send it as HOG input.
-     */
-    events_build_string(value, standard);
+    eventsCapture(values, standards);
+}
+#endif
+
+#if defined(CONFIG_CALIPER_PEAK)
+/*---------------------------------------------------------------------------*/
+/*  Hold ended: type the held statistic, as a snapshot would.                */
+/*---------------------------------------------------------------------------*/
+static void events_peak(const int32_t * values, const int * standards)
+{
+    LOG_INF("%s: Peak hold", __func__);
+
+    if (eventsLinkDown()) {
+        LOG_WRN("Bluetooth not connected");
+        buzzer_play(&ble_not_connected_sound);
+        return;
+    }
+
+    eventsCapture(values, standards);
+}
+#endif
+
+#if defined(CONFIG_CALIPER_BURST)
+/*---------------------------------------------------------------------------*/
+/*  SNAPSHOT held: capture a burst; released: type it.                       */
+/*---------------------------------------------------------------------------*/
+static void events_burst(buttons_id_t btn_id, bool held)
+{
+    (void) btn_id;   // unused
+
+    if (!held) {
+        burst_stop();
+        return;
+    }
+
+    LOG_INF("%s: Burst", __func__);
+
+    if (is_bt_connected() == false) {
+        LOG_WRN("Bluetooth not connected");
+        buzzer_play(&ble_not_connected_sound);
+        return;
+    }
 
-    keyboard_send_string((char*)&string);
+    burst_start();
 }
+#endif
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -127,6 +363,25 @@ static void events_ble_connect(bool connected)
 
 }
 
+#if defined(CONFIG_CALIPER_ACTIVITY)
+/*---------------------------------------------------------------------------*/
+/*  Caliper power transitions, from the CLOCK edge counter.                  */
+/*---------------------------------------------------------------------------*/
+static void events_caliper_power(bool on)
+{
+    LOG_INF("%s: caliper(%s)", __func__, (on) ? "ON" : "OFF");
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    /*
+     *  Frame timing does not survive a power cycle.
+     */
+    if (!on) {
+        phase_unlock();
+    }
+#endif
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -139,8 +394,36 @@ void events_init(void)
      */
     buttons_register_notify_handler(events_snapshot);
 
+#if defined(CONFIG_CALIPER_BURST)
+    /*
+     *  Register for button hold/release notifications.
+     */
+    buttons_register_hold_handler(events_burst);
+#endif
+
     /*
      *  Register for BLE connect/disconnect events.
      */
     ble_register_connect_handler(events_ble_connect);
+
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    /*
+     *  Register for caliper ON/OFF events.
+     */
+    activity_register_notify_handler(events_caliper_power);
+#endif
+
+#if defined(CONFIG_CALIPER_AUTO_CAPTURE)
+    /*
+     *  Register for settled readings.
+     */
+    autocap_register_notify_handler(events_auto_capture);
+#endif
+
+#if defined(CONFIG_CALIPER_PEAK)
+    /*
+     *  Register for ended holds.
+     */
+    peak_register_notify_handler(events_peak);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  filter.c  -- Noise filtering between decoding and publication
+ *
+ *  Requests, snapshots and auto-capture all see the filtered value.
+ *
+ *      median  median of the last CONFIG_CALIPER_FILTER_N readings
+ *      iir     y += alpha * (x - y), alpha in Q15
+ *      kalman  1-D constant-position Kalman, gain in Q15; it starts from
+ *              the raw reading and settles to the low-pass gain set by
+ *              the process/measurement noise ratio
+ *
+ *  Filter state is kept relative to the channel's reference value (the
+ *  reading at the last reset), as Q16 counts.  A reading further than
+ *  CONFIG_CALIPER_FILTER_RESET from the estimate is movement, not noise:
+ *  the filter restarts from it, so there is no lag when the jaws move.
+ *  Deviations are therefore small, and every product is one 32 x 32 ->
+ *  64 multiply (SMULL/SMLAL on the M4).
+ *
+ *  The same ring gives the averaged snapshot: the mean of the last N
+ *  readings, once N have arrived since the last reset.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "filter.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(filter, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define FILTER_N        CONFIG_CALIPER_FILTER_N
+#define FILTER_FRAC     16
+
+/* Deviations beyond this (counts) move the reference, to stay in Q16. */
+#define FILTER_REBASE   (1 << 13)
+
+#if defined(CONFIG_CALIPER_FILTER_DEFAULT_MEDIAN)
+#define FILTER_MODE_DEFAULT   FILTER_MEDIAN
+#elif defined(CONFIG_CALIPER_FILTER_DEFAULT_IIR)
+#define FILTER_MODE_DEFAULT   FILTER_IIR
+#elif defined(CONFIG_CALIPER_FILTER_DEFAULT_KALMAN)
+#define FILTER_MODE_DEFAULT   FILTER_KALMAN
+#else
+#define FILTER_MODE_DEFAULT   FILTER_OFF
+#endif
+
+/* alpha, and the Kalman noise ratio Q/R, as Q15 and Q16 */
+#define FILTER_ALPHA_Q15   ((CONFIG_CALIPER_FILTER_IIR_ALPHA * 32768) / 100)
+#define FILTER_RATIO_Q16   ((CONFIG_CALIPER_FILTER_KALMAN_RATIO * 65536) / 100)
+
+typedef struct {
+    bool      have;
+    uint8_t   standard;
+    int32_t   reference;          // reading the filter restarted from
+    int32_t   ring [FILTER_N];    // raw readings, relative to reference
+    uint32_t  samples;            // since the last reset
+    int32_t   estimate;           // Q16, relative to reference
+    int32_t   variance;           // Kalman P, Q16 of R
+    filter_stats_t stats;
+} filter_channel_t;
+
+static filter_channel_t channels [CALIPER_CHANNELS];
+
+static filter_mode_t mode = FILTER_MODE_DEFAULT;
+static bool average = IS_ENABLED(CONFIG_CALIPER_FILTER_AVERAGE);
+
+static struct k_spinlock filter_lock;
+
+static const char * const mode_names [] = {
+    [FILTER_OFF]    = "off",
+    [FILTER_MEDIAN] = "median",
+    [FILTER_IIR]    = "iir",
+    [FILTER_KALMAN] = "kalman",
+};
+
+/*---------------------------------------------------------------------------*/
+/*  Q16 to counts, rounded half away from zero.                              */
+/*---------------------------------------------------------------------------*/
+static int32_t filterRound(int32_t q16)
+{
+    if (q16 < 0) {
+        return -((-q16 + (1 << (FILTER_FRAC - 1))) >> FILTER_FRAC);
+    }
+    return (q16 + (1 << (FILTER_FRAC - 1))) >> FILTER_FRAC;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Restart the channel from reading x.                                      */
+/*---------------------------------------------------------------------------*/
+static void filterReset(filter_channel_t * ch, int32_t x, uint8_t standard)
+{
+    if (ch->have) {
+        ch->stats.resets++;
+    }
+    ch->have      = true;
+    ch->standard  = standard;
+    ch->reference = x;
+    ch->samples   = 0;
+    ch->estimate  = 0;
+    ch->variance  = 1 << FILTER_FRAC;    // start with P = R: gain 1/2
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Slow movement, each step within the reset limit, walks the readings     */
+/*  away from the reference: move the reference to the estimate.            */
+/*---------------------------------------------------------------------------*/
+static void filterRebase(filter_channel_t * ch)
+{
+    int32_t shift = filterRound(ch->estimate);
+
+    ch->reference += shift;
+    ch->estimate  -= shift << FILTER_FRAC;
+
+    for (int i=0; i < FILTER_N; i++) {
+        ch->ring[i] -= shift;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Median of the ring so far (lower middle if even), by insertion sort.     */
+/*---------------------------------------------------------------------------*/
+static int32_t filterMedian(const filter_channel_t * ch)
+{
+    int32_t sorted [FILTER_N];
+    int     count = MIN(ch->samples, FILTER_N);
+    int32_t x;
+    int     i, j;
+
+    for (i=0; i < count; i++) {
+        x = ch->ring[i];
+        for (j=i; j > 0 && sorted[j-1] > x; j--) {
+            sorted[j] = sorted[j-1];
+        }
+        sorted[j] = x;
+    }
+    return sorted[(count - 1) / 2] << FILTER_FRAC;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  y += alpha * (x - y)                                                     */
+/*---------------------------------------------------------------------------*/
+static int32_t filterIir(const filter_channel_t * ch, int32_t x)
+{
+    int32_t error = (x << FILTER_FRAC) - ch->estimate;
+
+    return ch->estimate + (int32_t)(((int64_t) error * FILTER_ALPHA_Q15) >> 15);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Predict: P += Q.  Update: K = P / (P + R), y += K (x - y), P -= K P.     */
+/*  R is 1.0 (Q16); Q is the configured ratio.                               */
+/*---------------------------------------------------------------------------*/
+static int32_t filterKalman(filter_channel_t * ch, int32_t x)
+{
+    int32_t error = (x << FILTER_FRAC) - ch->estimate;
+    int32_t p     = ch->variance + FILTER_RATIO_Q16;
+    int32_t gain  = (int32_t)(((int64_t) p << 15) / (p + (1 << FILTER_FRAC)));
+
+    ch->variance = p - (int32_t)(((int64_t) gain * p) >> 15);
+
+    return ch->estimate + (int32_t)(((int64_t) error * gain) >> 15);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Caliper thread, after each good reading: replace value with the         */
+/*  filtered one.                                                            */
+/*---------------------------------------------------------------------------*/
+void filter_reading(caliper_reading_t * reading)
+{
+    filter_channel_t * ch = &channels[reading->channel];
+    int32_t limit = CALIPER_UM_TO_COUNTS(CONFIG_CALIPER_FILTER_RESET,
+                                         reading->standard);
+    int32_t x;
+    k_spinlock_key_t key;
+
+#if defined(CONFIG_CALIPER_DECODER_BENCHMARK)
+    timing_t start = timing_counter_get();
+#endif
+
+    key = k_spin_lock(&filter_lock);
+
+    if (!ch->have || ch->standard != reading->standard ||
+        abs(reading->value - ch->reference -
+            filterRound(ch->estimate)) > limit) {
+        filterReset(ch, reading->value, reading->standard);
+    }
+    else if (abs(reading->value - ch->reference) > FILTER_REBASE) {
+        filterRebase(ch);
+    }
+
+    x = reading->value - ch->reference;
+
+    ch->ring[ch->samples % FILTER_N] = x;
+    ch->samples++;
+    ch->stats.frames++;
+
+    if (ch->samples == 1) {
+        ch->estimate = x << FILTER_FRAC;
+    }
+    else {
+        switch (mode) {
+            case FILTER_MEDIAN: ch->estimate = filterMedian(ch);    break;
+            case FILTER_IIR:    ch->estimate = filterIir(ch, x);    break;
+            case FILTER_KALMAN: ch->estimate = filterKalman(ch, x); break;
+            default:            ch->estimate = x << FILTER_FRAC;    break;
+        }
+    }
+
+    reading->value = ch->reference + filterRound(ch->estimate);
+
+    k_spin_unlock(&filter_lock, key);
+
+#if defined(CONFIG_CALIPER_DECODER_BENCHMARK)
+    timing_t end = timing_counter_get();
+
+    ch->stats.last_ns = (uint32_t) timing_cycles_to_ns(
+                                        timing_cycles_get(&start, &end));
+    ch->stats.max_ns  = MAX(ch->stats.max_ns, ch->stats.last_ns);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Mean of the last FILTER_N readings, rounded half away from zero.         */
+/*  -EAGAIN until that many have arrived since the jaws last moved.          */
+/*---------------------------------------------------------------------------*/
+int filter_average(int channel, int32_t * value, int * standard)
+{
+    filter_channel_t * ch;
+    int32_t sum = 0;
+    int     ret = 0;
+    k_spinlock_key_t key;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+    ch = &channels[channel];
+
+    key = k_spin_lock(&filter_lock);
+
+    if (!ch->have) {
+        ret = -ENODATA;
+    }
+    else if (ch->samples < FILTER_N) {
+        ret = -EAGAIN;
+    }
+    else {
+        for (int i=0; i < FILTER_N; i++) {
+            sum += ch->ring[i];
+        }
+        sum = (sum < 0) ? -((-sum + FILTER_N / 2) / FILTER_N) :
+                          ((sum + FILTER_N / 2) / FILTER_N);
+
+        *value    = ch->reference + sum;
+        *standard = ch->standard;
+    }
+
+    k_spin_unlock(&filter_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Takes effect from the next reading; every channel restarts.              */
+/*---------------------------------------------------------------------------*/
+void filter_set_mode(filter_mode_t new_mode)
+{
+    k_spinlock_key_t key = k_spin_lock(&filter_lock);
+
+    mode = new_mode;
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        channels[i].have = false;
+    }
+
+    k_spin_unlock(&filter_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+filter_mode_t filter_get_mode(void)
+{
+    return mode;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+const char * filter_mode_name(filter_mode_t filter_mode)
+{
+    if ((unsigned) filter_mode >= ARRAY_SIZE(mode_names)) {
+        return NULL;
+    }
+    return mode_names[filter_mode];
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Averaged snapshots: SNAPSHOT types filter_average() instead.             */
+/*---------------------------------------------------------------------------*/
+void filter_set_average(bool enable)
+{
+    average = enable;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool filter_average_enabled(void)
+{
+    return average;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void filter_get_stats(int channel, filter_stats_t * stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&filter_lock);
+
+    *stats = channels[channel].stats;
+
+    k_spin_unlock(&filter_lock, key);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  fixed.c  -- Integer helpers for fixed-point arithmetic
+ *
+ *  Shared by units conversion, statistics and SPC, which all work in
+ *  64-bit integers and round once at the end.
+ */
+#include <zephyr/kernel.h>
+
+#include "fixed.h"
+
+/*---------------------------------------------------------------------------*/
+/*  numerator / denominator, rounded half away from zero (denominator > 0).  */
+/*---------------------------------------------------------------------------*/
+int64_t fixed_div_round(int64_t numerator, int64_t denominator)
+{
+    if (numerator < 0) {
+        return -((-numerator + denominator / 2) / denominator);
+    }
+    return (numerator + denominator / 2) / denominator;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  floor(sqrt(value)), bit by bit.                                          */
+/*---------------------------------------------------------------------------*/
+uint32_t fixed_sqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit  = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root   = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) root;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  format.c  -- Integer fixed-point formatting of readings
+ *
+ *  Readings are counts of 10^-CALIPER_MM_DECIMALS mm or
+ *  10^-CALIPER_INCH_DECIMALS inch.  They are rendered with fewer decimals
+ *  by rounding half away from zero, digit by digit, without floating
+ *  point or printf.
+ */
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include "format.h"
+#include "caliper.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static const uint32_t powers [] = {
+    1, 10, 100, 1000, 10000, 100000,
+};
+
+BUILD_ASSERT(CALIPER_MM_DECIMALS < ARRAY_SIZE(powers) &&
+             CALIPER_INCH_DECIMALS < ARRAY_SIZE(powers),
+             "powers[] too short for the reading resolution");
+
+/*---------------------------------------------------------------------------*/
+/*  Render value as [-]int[.frac] into buffer, NUL terminated.  decimals is  */
+/*  capped at the reading resolution.  Returns the length, or -ENOSPC.       */
+/*---------------------------------------------------------------------------*/
+int format_value(char * buffer, size_t size, int32_t value, int standard,
+                 int decimals)
+{
+    char     digits [16];     // reversed: fraction, '.', integer, sign
+    int      native;
+    int      count = 0;
+    uint32_t magnitude;
+
+    if (standard == CALIPER_STANDARD_MM) {
+        native = CALIPER_MM_DECIMALS;
+        if (decimals < 0) {
+            decimals = CONFIG_CALIPER_OUTPUT_MM_DECIMALS;
+        }
+    }
+    else {
+        native = CALIPER_INCH_DECIMALS;
+        if (decimals < 0) {
+            decimals = CONFIG_CALIPER_OUTPUT_INCH_DECIMALS;
+        }
+    }
+    decimals = MIN(decimals, native);
+
+    magnitude = (value < 0) ? (0u - (uint32_t) value) : (uint32_t) value;
+
+    if (decimals < native) {
+        uint32_t divisor = powers[native - decimals];
+
+        magnitude = (magnitude + divisor / 2) / divisor;
+    }
+
+    for (int i=0; i < decimals; i++) {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    }
+    if (decimals > 0) {
+        digits[count++] = '.';
+    }
+    do {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    /*
+     *  No "-0.00": a value that rounds to zero has no sign.
+     */
+    if (value < 0) {
+        for (int i=0; i < count; i++) {
+            if (digits[i] > '0') {
+                digits[count++] = '-';
+                break;
+            }
+        }
+    }
+
+    if ((size_t) count >= size) {
+        return -ENOSPC;
+    }
+    for (int i=0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    buffer[count] = '\0';
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Parse [+|-]int[.frac] into reading counts of the given standard.         */
+/*  Digits past the reading resolution round half away from zero.           */
+/*  Returns 0, or -EINVAL on bad syntax, -ERANGE if it does not fit.         */
+/*---------------------------------------------------------------------------*/
+int format_parse(const char * text, int standard, int32_t * value)
+{
+    int      native = (standard == CALIPER_STANDARD_MM) ?
+                      CALIPER_MM_DECIMALS : CALIPER_INCH_DECIMALS;
+    bool     negative = false;
+    bool     digits = false;
+    int      decimals = -1;     // -1 until the decimal point
+    uint64_t magnitude = 0;
+
+    if (*text == '+' || *text == '-') {
+        negative = (*text == '-');
+        text++;
+    }
+
+    for (; *text != '\0'; text++) {
+        if (*text == '.' && decimals < 0) {
+            decimals = 0;
+            continue;
+        }
+        if (*text < '0' || *text > '9') {
+            return -EINVAL;
+        }
+        digits = true;
+
+        if (decimals < native) {
+            magnitude = magnitude * 10 + (*text - '0');
+            if (decimals >= 0) {
+                decimals++;
+            }
+        }
+        else if (decimals == native) {
+            magnitude += (*text >= '5');    // first digit past: round
+            decimals++;
+        }
+        if (magnitude > INT32_MAX) {
+            return -ERANGE;
+        }
+    }
+    if (!digits) {
+        return -EINVAL;
+    }
+
+    for (decimals = MAX(decimals, 0); decimals < native; decimals++) {
+        magnitude *= 10;
+        if (magnitude > INT32_MAX) {
+            return -ERANGE;
+        }
+    }
+
+    *value = negative ? -(int32_t) magnitude : (int32_t) magnitude;
+
+    return 0;
+}
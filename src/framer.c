@@ -13,6 +13,11 @@
 #include "framer.h"
 #include "caliper.h"
 #include "caliper_gpio.h"
+#include "edge_capture.h"
+#include "phase.h"
+#include "activity.h"
+#include "decoder.h"
+#include "readings.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(framer, LOG_LEVEL_INF);
@@ -21,7 +26,16 @@ LOG_MODULE_REGISTER(framer, LOG_LEVEL_INF);
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
-#define FRAMER_FRAME_TOTAL_BITS  24
+/* Frame length until the decoder knows the protocol (24-bit binary). */
+#define FRAMER_FRAME_BITS        24
+
+/*
+ *  Slow-mode timing, used as is until the frame rate is known and as
+ *  upper bounds after: give up counting bits after ALIGN, then sleep
+ *  SETTLE into the gap.
+ */
+#define FRAMER_ALIGN_US          30000
+#define FRAMER_SETTLE_US         20000
 
 #define HIGH        1
 #define LOW         0
@@ -70,12 +84,105 @@ static void framerWrite(const struct gpio_dt_spec * spec, int val)
 /*---------------------------------------------------------------------------*/
 bool is_caliper_on(void)
 {
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    caliper_power_state = activity_is_on();
+#endif
+
     LOG_INF("%s: %s", __func__, 
            (caliper_power_state == CALIPER_POWER_ON) ? "ON" : "OFF");
 
     return caliper_power_state;
 }
 
+/*---------------------------------------------------------------------------*/
+/*  Bits per frame of the channel's protocol.                                */
+/*---------------------------------------------------------------------------*/
+static int framerFrameBits(int channel)
+{
+    int bits = decoder_frame_bits(channel);
+
+    return (bits > 0) ? bits : FRAMER_FRAME_BITS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Frame period, measured: from the CLOCK edge rate when the activity       */
+/*  counter watches this channel, else from consecutive readings.  0 if      */
+/*  not known yet.                                                           */
+/*---------------------------------------------------------------------------*/
+uint32_t framer_frame_period_us(int channel)
+{
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    if (channel == 0) {
+        activity_stats_t stats;
+
+        activity_get_stats(&stats);
+        if (stats.edge_rate != 0) {
+            return (uint32_t) ((1000000ULL * framerFrameBits(channel)) /
+                               stats.edge_rate);
+        }
+    }
+#endif
+    return readings_frame_period_us(channel);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Time the caliper spends clocking out one frame.                          */
+/*---------------------------------------------------------------------------*/
+uint32_t framer_frame_us(int channel)
+{
+    uint32_t bit_us = decoder_bit_period_us(channel);
+
+    if (bit_us == 0) {
+        return CONFIG_CALIPER_FRAME_TIME_US;
+    }
+    return bit_us * framerFrameBits(channel);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  CLOCK idle this long ends a frame: CALIPER_GAP_US, but no more than      */
+/*  half the measured interframe gap (fast mode) and no less than a few      */
+/*  bit periods.                                                             */
+/*---------------------------------------------------------------------------*/
+uint32_t framer_gap_us(int channel)
+{
+    uint32_t period   = framer_frame_period_us(channel);
+    uint32_t frame_us = framer_frame_us(channel);
+    uint32_t gap      = CONFIG_CALIPER_GAP_US;
+
+    if (period > frame_us) {
+        gap = MIN(gap, (period - frame_us) / 2);
+    }
+    return MAX(gap, 3 * decoder_bit_period_us(channel));
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Bit counting that started mid-frame must time out before it could run    */
+/*  on into the next frame: less than a frame period.                        */
+/*---------------------------------------------------------------------------*/
+static uint32_t framerAlignUs(void)
+{
+    uint32_t period = framer_frame_period_us(0);
+
+    if (period == 0) {
+        return FRAMER_ALIGN_US;
+    }
+    return MIN(FRAMER_ALIGN_US, (period + framer_frame_us(0)) / 2);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Sleep into the gap, without sleeping through it.                         */
+/*---------------------------------------------------------------------------*/
+static uint32_t framerSettleUs(void)
+{
+    uint32_t period   = framer_frame_period_us(0);
+    uint32_t frame_us = framer_frame_us(0);
+
+    if (period <= frame_us) {
+        return FRAMER_SETTLE_US;
+    }
+    return MIN(FRAMER_SETTLE_US, (period - frame_us) / 4);
+}
+
 #if logic_analyzer_testing
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -120,15 +227,84 @@ void framerAlignmentCallback(struct k_timer * timer)
     k_timer_stop(&framer_alignment_timer);
 }
 
+#if defined(CONFIG_CALIPER_CAPTURE_DIGIMATIC)
+/*---------------------------------------------------------------------------*/
+/*  Digimatic gauges are silent until requested: nothing to align with.      */
+/*  A gauge that is off shows up as a read timeout instead.                  */
+/*---------------------------------------------------------------------------*/
+void framer_find_interframe_gap(void)
+{
+    LOG_DBG("%s", __func__);
+
+    caliper_power_state = CALIPER_POWER_ON;
+}
+
+#elif defined(CONFIG_CALIPER_CAPTURE_EDGE)
+/*---------------------------------------------------------------------------*/
+/*  The edge engine finds the gap with a TIMER compare: just wait for it.    */
+/*  NOTE: this function runs on workqueue thread, not interrupt level         */
+/*---------------------------------------------------------------------------*/
+void framer_find_interframe_gap(void)
+{
+    LOG_DBG("%s", __func__);
+
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    if (!activity_is_on()) {
+        caliper_power_state = CALIPER_POWER_OFF;
+        return;
+    }
+#endif
+
+    if (edge_capture_wait_gap(0, K_MSEC(500)) == 0) {
+        caliper_power_state = CALIPER_POWER_ON;
+        LOG_DBG("Found interframe gap");
+    }
+    else {
+        caliper_power_state = CALIPER_POWER_OFF;
+        LOG_DBG("Caliper is \"OFF\"");
+    }
+}
+
+#else
 /*---------------------------------------------------------------------------*/
 /* NOTE: this function runs on workqueue thread, not interrupt level         */
 /*---------------------------------------------------------------------------*/
 void framer_find_interframe_gap(void)
 {
+    int bits;
     int i;
 
     LOG_DBG("%s", __func__);
 
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    /*
+     *  The edge counter already knows the caliper is off: don't spin
+     *  500 msecs to find out again.
+     */
+    if (!activity_is_on()) {
+        caliper_power_state = CALIPER_POWER_OFF;
+        return;
+    }
+#endif
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    /*
+     *  Phase locked: sleep until just before the predicted frame start,
+     *  the caller then arms the CLOCK interrupt.  No gap search needed.
+     */
+    int64_t arm;
+
+    if (phase_predict(&arm) == 0) {
+        int64_t wait = arm - phase_now_us();
+
+        if (wait > 0) {
+            k_sleep(K_USEC(wait));
+        }
+        caliper_power_state = CALIPER_POWER_ON;
+        return;
+    }
+#endif
+
     active  = true;
     aligned = true;
 
@@ -143,9 +319,12 @@ void framer_find_interframe_gap(void)
 
     while (active) {
 
-        k_timer_start(&framer_alignment_timer, K_MSEC(30), K_NO_WAIT);
+        k_timer_start(&framer_alignment_timer, K_USEC(framerAlignUs()),
+                      K_NO_WAIT);
+
+        bits = framerFrameBits(0);
 
-        for (i=0; i < (FRAMER_FRAME_TOTAL_BITS); i++) {
+        for (i=0; i < bits; i++) {
             while (active && aligned && framerRead(&clock_spec) == LOW)  { /*spin*/}
             while (active && aligned && framerRead(&clock_spec) == HIGH) { /*spin*/}
         }
@@ -159,28 +338,32 @@ void framer_find_interframe_gap(void)
 
         /*
          *  If started in middle of frame, e.g. misaligned, then
-         *  delay a bit (20ms) and keep searching.
+         *  delay a bit (20ms, less in fast mode) and keep searching.
          */
         if (!aligned) {
-            k_sleep(K_MSEC(20));
+            k_sleep(K_USEC(framerSettleUs()));
             aligned = true;
             continue;
         }
 
-        if (i == FRAMER_FRAME_TOTAL_BITS) {
+        if (i == bits) {
              /*
               *  Wait for clock to finally go high: it's interframe value.
               */
             while (framerRead(&clock_spec) == LOW)  { /*spin*/}
 
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+            phase_frame_end(phase_now_us());
+#endif
             caliper_power_state = CALIPER_POWER_ON;
 
             /*
-             *  Delay a bit to insure truly in interframe gap.
+             *  Delay a bit to insure truly in interframe gap, but not
+             *  past the next frame when the caliper is in fast mode.
              *  The next frame will be detected by enabling interrupts 
              *  on clock line.  see caliper_read_value().
              */
-            k_sleep(K_MSEC(20));
+            k_sleep(K_USEC(framerSettleUs()));
 
 #if logic_analyzer_testing             
             framerPulseDebug();  // indicate near start of next frame.
@@ -196,6 +379,7 @@ void framer_find_interframe_gap(void)
         }
     }
 }
+#endif
 
 
 /*---------------------------------------------------------------------------*/
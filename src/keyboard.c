@@ -128,16 +128,32 @@ static const uint8_t report_map[] = {
   };
 
 /* 
- *  String descriptor
+ *  Keystrokes being typed, one report per notify completion.
  */
 typedef struct {
-    char * string;
-    int    length;
-    int    index;
-} string_desc_t;
+    keyboard_key_t keys [CONFIG_CALIPER_OUTPUT_MAX_KEYS];
+    int            length;
+    int            index;
+} key_desc_t;
 
 static void notify_callback(struct bt_conn * conn, void *user_data);
-static void keyboard_send_char(string_desc_t * string_desc);
+static void keyboard_send_char(key_desc_t * key_desc);
+
+/*
+ *  Streamed keystrokes: producers queue them, the notify completions
+ *  drain them a batch at a time, so rendering and sending overlap.
+ */
+K_MSGQ_DEFINE(keyboard_queue, sizeof(keyboard_key_t),
+              CONFIG_CALIPER_KEYBOARD_QUEUE_SIZE, 1);
+
+static key_desc_t stream_desc;
+static atomic_t   keyboard_busy;
+
+/* Given each time typing stops. */
+K_SEM_DEFINE(keyboard_idle_sem, 0, 1);
+
+/* Set by a quiet send: no completion chirp when this typing stops. */
+static atomic_t   keyboard_quiet;
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -262,50 +278,84 @@ static struct bt_gatt_notify_params params = {
 //  .user_data = &string_desc,  // dynamically set
 };
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool keyboardStreamNext(void)
+{
+    int count = 0;
+
+    while (count < ARRAY_SIZE(stream_desc.keys) &&
+           k_msgq_get(&keyboard_queue, &stream_desc.keys[count],
+                      K_NO_WAIT) == 0) {
+        count++;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    stream_desc.length = count;
+    stream_desc.index  = 0;
+
+    keyboard_send_char(&stream_desc);
+
+    return true;
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 static void notify_callback(struct bt_conn * conn, void * user_data)
 {
-    string_desc_t * string_desc = user_data;
+    key_desc_t * key_desc = user_data;
 
-    string_desc->index++;
+    key_desc->index++;
 
-    if (string_desc->string[string_desc->index] == 0) {
-        buzzer_play(&send_completed_sound);
+    if (key_desc->index < key_desc->length) {
+        keyboard_send_char(key_desc);
+        return;
+    }
+
+    /*
+     *  Done with this batch: carry on with queued keys, if any.  Idle is
+     *  published before the last look, so a producer that queues keys
+     *  meanwhile sees it and kicks the queue itself.
+     */
+    if (keyboardStreamNext()) {
         return;
-    }        
+    }
+    atomic_clear(&keyboard_busy);
+
+    if (k_msgq_num_used_get(&keyboard_queue) > 0 &&
+        atomic_cas(&keyboard_busy, 0, 1)) {
+        if (keyboardStreamNext()) {
+            return;
+        }
+        atomic_clear(&keyboard_busy);
+    }
+
+    k_sem_give(&keyboard_idle_sem);
 
-    if (string_desc->index <= string_desc->length) {
-        keyboard_send_char(string_desc);
+    if (!atomic_clear(&keyboard_quiet)) {
+        buzzer_play(&send_completed_sound);
     }
 }
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-static void keyboard_send_char(string_desc_t * string_desc)
+static void keyboard_send_char(key_desc_t * key_desc)
 {
     int ret;
-    int keycode;
+    const keyboard_key_t * key = &key_desc->keys[key_desc->index];
 
     /*
      *  Encode Report with Key code
      */
-    keycode = ascii_to_hid(string_desc->string[string_desc->index]);
+    report[0] = key->modifier;
+    report[2] = key->code;
 
-    if (keycode == -1) {
-        LOG_WRN("bad char in string: 0x%02X", 
-                string_desc->string[string_desc->index]);
-        return;
-    }
-
-    if (needs_shift(string_desc->string[string_desc->index])) {
-        report[0] |= HID_KBD_MODIFIER_RIGHT_SHIFT;
-    }
-    report[2] = keycode;
-
-    params.user_data = string_desc;
+    params.user_data = key_desc;
 
     /*
      *  Send Key Press
@@ -313,6 +363,10 @@ static void keyboard_send_char(string_desc_t * string_desc)
     ret = bt_gatt_notify_cb(NULL, &params);
     if (ret) {
         LOG_WRN("bt_gatt_notify_cb: ret(%d)", ret);
+        /* No completion will follow: typing stops here. */
+        atomic_clear(&keyboard_busy);
+        atomic_clear(&keyboard_quiet);
+        k_sem_give(&keyboard_idle_sem);
     }
 
     /*
@@ -323,19 +377,128 @@ static void keyboard_send_char(string_desc_t * string_desc)
     bt_gatt_notify(NULL, &hog_svc.attrs[5], report, sizeof(report));
 }
 
+/*---------------------------------------------------------------------------*/
+/*  Keystroke for a printable ASCII character (or newline); -EINVAL if none. */
+/*---------------------------------------------------------------------------*/
+int keyboard_ascii_key(uint8_t ascii, keyboard_key_t * key)
+{
+    int keycode = ascii_to_hid(ascii);
+
+    if (keycode == -1) {
+        return -EINVAL;
+    }
+
+    key->modifier = needs_shift(ascii) ? HID_KBD_MODIFIER_RIGHT_SHIFT : 0;
+    key->code     = keycode;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Type count keystrokes, after anything still being typed.  quiet: the     */
+/*  caller has sounded its own confirmation, so no chirp when done.          */
+/*---------------------------------------------------------------------------*/
+void keyboard_send_keys(const keyboard_key_t * keys, int count, bool quiet)
+{
+    static key_desc_t key_desc;
+
+    if (!is_bt_connected() || count <= 0) {
+        return;
+    }
+
+    if (quiet) {
+        atomic_set(&keyboard_quiet, 1);
+    }
+
+    if (count > ARRAY_SIZE(key_desc.keys)) {
+        LOG_WRN("%d keys, only %d typed", count, ARRAY_SIZE(key_desc.keys));
+        count = ARRAY_SIZE(key_desc.keys);
+    }
+
+    /* One chain of notifications at a time: if busy, go in the queue. */
+    if (!atomic_cas(&keyboard_busy, 0, 1)) {
+        if (keyboard_queue_keys(keys, count, K_NO_WAIT) < count) {
+            LOG_WRN("keyboard queue full");
+        }
+        return;
+    }
+
+    memcpy(key_desc.keys, keys, count * sizeof(keyboard_key_t));
+    key_desc.length = count;
+    key_desc.index  = 0;
+
+    keyboard_send_char(&key_desc);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Queue count keystrokes behind anything being typed, waiting up to        */
+/*  timeout for room.  Returns the number queued; fewer on timeout, or       */
+/*  -ENOTCONN.                                                               */
+/*---------------------------------------------------------------------------*/
+int keyboard_queue_keys(const keyboard_key_t * keys, int count,
+                        k_timeout_t timeout)
+{
+    int queued = 0;
+
+    if (!is_bt_connected()) {
+        return -ENOTCONN;
+    }
+
+    while (queued < count) {
+        if (k_msgq_put(&keyboard_queue, &keys[queued], timeout) != 0) {
+            break;
+        }
+        queued++;
+
+        /*
+         *  Kick the queue when idle, as soon as there is something in it,
+         *  so sending starts while the rest is still being rendered.
+         */
+        if (atomic_cas(&keyboard_busy, 0, 1) && !keyboardStreamNext()) {
+            atomic_clear(&keyboard_busy);
+        }
+    }
+
+    return queued;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Wait until everything queued has been typed; -EAGAIN on timeout.         */
+/*---------------------------------------------------------------------------*/
+int keyboard_queue_drain(k_timeout_t timeout)
+{
+    while (atomic_get(&keyboard_busy) ||
+           k_msgq_num_used_get(&keyboard_queue) > 0) {
+        if (k_sem_take(&keyboard_idle_sem, timeout) != 0) {
+            return -EAGAIN;
+        }
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Drop any queued keystrokes not yet sent.                                 */
+/*---------------------------------------------------------------------------*/
+void keyboard_queue_flush(void)
+{
+    k_msgq_purge(&keyboard_queue);
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 void keyboard_send_string(char * string)
 {
-    if (is_bt_connected()) {
-
-      static string_desc_t string_desc = {NULL, 0, 0};
-      
-      string_desc.string = string;
-      string_desc.length = strlen(string);
-      string_desc.index  = 0; 
-      
-      keyboard_send_char( &string_desc );
+    static keyboard_key_t keys [CONFIG_CALIPER_OUTPUT_MAX_KEYS];
+    int count = 0;
+
+    for (; *string && count < ARRAY_SIZE(keys); string++) {
+        if (keyboard_ascii_key(*string, &keys[count]) != 0) {
+            LOG_WRN("bad char in string: 0x%02X", *string);
+            continue;
+        }
+        count++;
     }
+
+    keyboard_send_keys(keys, count, false);
 }
@@ -16,6 +16,12 @@
 #include "ble_alt.h"
 #include "framer.h"
 #include "buzzer.h"
+#include "activity.h"
+#include "output.h"
+#include "units.h"
+#include "tolerance.h"
+#include "datum.h"
+#include "session.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main, 3);
@@ -96,6 +102,20 @@ void main_thread(void * id, void * unused1, void * unused2)
 
     app_uicr_init();
 
+    units_init();
+
+#if defined(CONFIG_CALIPER_TOLERANCE)
+    tolerance_init();
+#endif
+
+#if defined(CONFIG_CALIPER_DATUM)
+    datum_init();
+#endif
+
+#if defined(CONFIG_CALIPER_SESSION)
+    session_init();
+#endif
+
     buttons_init();
 
     if (boot_button_state() == BOOT_OPTIONS_ALTERNATE) {
@@ -117,6 +137,12 @@ void main_thread(void * id, void * unused1, void * unused2)
 
     caliper_init();
 
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    activity_init();
+#endif
+
+    output_init();
+
     events_init();
 
     caliper_shell_init();
@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  output.c  -- Output template engine
+ *
+ *  What is typed for each reading comes from a template, compiled once
+ *  (when set) into a byte program; rendering a reading then only walks
+ *  the program, appending keystrokes.  Literal text and named keys are
+ *  turned into HID keystrokes at compile time.
+ *
+ *  Template syntax: text is typed as is, "{{" types "{", and
+ *      {value}     reading, CALIPER_OUTPUT_xx_DECIMALS decimals
+ *      {value:N}   reading, N decimals
+ *      {unit}      "mm" or "inch"
+ *      {suffix}    " mm" or " inch" if "caliper standard" is INCLUDE
+ *      {channel}   caliper channel number
+ *      {seq}       reading sequence number
+ *      {ms}        uptime when decoded, msecs
+ *      {eol}       ENTER if "caliper line_end" is NEWLINE
+ *      {sep}       TAB between channels, {eol} after the last
+ *      {tab} {enter} {esc} {space} {bs} {del} {up} {down} {left}
+ *      {right} {home} {end} {pgup} {pgdn}    keys
+ *  Readings are typed one after the other, channel order, each through
+ *  the whole template.
+ */
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include "output.h"
+#include "format.h"
+#include "caliper.h"
+#include "app_uicr.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(output, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define OUTPUT_PROGRAM_SIZE   CONFIG_CALIPER_OUTPUT_PROGRAM_SIZE
+#define OUTPUT_TEMPLATE_SIZE  CONFIG_CALIPER_OUTPUT_PROGRAM_SIZE
+
+typedef enum {
+    OP_END = 0,
+    OP_KEYS,          // count, then count (modifier, code) pairs
+    OP_VALUE,         // decimals, or 0xFF for the Kconfig default
+    OP_UNIT,
+    OP_SUFFIX,
+    OP_CHANNEL,
+    OP_SEQ,
+    OP_MS,
+    OP_EOL,
+    OP_SEP,
+} output_op_t;
+
+typedef struct {
+    const char * name;
+    uint8_t      op;
+    uint8_t      code;     // HID key code, for OP_KEYS
+} output_name_t;
+
+static const output_name_t names [] = {
+    { "value",   OP_VALUE,   0 },
+    { "unit",    OP_UNIT,    0 },
+    { "suffix",  OP_SUFFIX,  0 },
+    { "channel", OP_CHANNEL, 0 },
+    { "seq",     OP_SEQ,     0 },
+    { "ms",      OP_MS,      0 },
+    { "eol",     OP_EOL,     0 },
+    { "sep",     OP_SEP,     0 },
+    { "tab",     OP_KEYS,    HID_KEY_TAB },
+    { "enter",   OP_KEYS,    HID_KEY_ENTER },
+    { "esc",     OP_KEYS,    HID_KEY_ESC },
+    { "space",   OP_KEYS,    HID_KEY_SPACE },
+    { "bs",      OP_KEYS,    HID_KEY_BACKSPACE },
+    { "del",     OP_KEYS,    HID_KEY_DELETE },
+    { "up",      OP_KEYS,    HID_KEY_UP },
+    { "down",    OP_KEYS,    HID_KEY_DOWN },
+    { "left",    OP_KEYS,    HID_KEY_LEFT },
+    { "right",   OP_KEYS,    HID_KEY_RIGHT },
+    { "home",    OP_KEYS,    HID_KEY_HOME },
+    { "end",     OP_KEYS,    HID_KEY_END },
+    { "pgup",    OP_KEYS,    HID_KEY_PAGEUP },
+    { "pgdn",    OP_KEYS,    HID_KEY_PAGEDOWN },
+};
+
+K_MUTEX_DEFINE(output_mutex);
+
+static uint8_t program [OUTPUT_PROGRAM_SIZE];
+static char    template_text [OUTPUT_TEMPLATE_SIZE];
+
+/*---------------------------------------------------------------------------*/
+/*  Compiler state                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint8_t * code;
+    int       length;
+    int       keys;       // offset of the open OP_KEYS count, or -1
+} output_compiler_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputEmit(output_compiler_t * c, uint8_t byte)
+{
+    if (c->length >= OUTPUT_PROGRAM_SIZE - 1) {   // room for OP_END
+        return -ENOSPC;
+    }
+    c->code[c->length++] = byte;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Append a keystroke, to the open OP_KEYS run if there is one.             */
+/*---------------------------------------------------------------------------*/
+static int outputEmitKey(output_compiler_t * c, uint8_t modifier, uint8_t code)
+{
+    if (c->keys < 0 || c->code[c->keys] == UINT8_MAX) {
+        if (outputEmit(c, OP_KEYS) != 0) {
+            return -ENOSPC;
+        }
+        c->keys = c->length;
+        if (outputEmit(c, 0) != 0) {
+            return -ENOSPC;
+        }
+    }
+    if (outputEmit(c, modifier) != 0 || outputEmit(c, code) != 0) {
+        return -ENOSPC;
+    }
+    c->code[c->keys]++;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputEmitOp(output_compiler_t * c, uint8_t op)
+{
+    c->keys = -1;
+    return outputEmit(c, op);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  One "{...}" placeholder, without the braces.                             */
+/*---------------------------------------------------------------------------*/
+static int outputCompileName(output_compiler_t * c, const char * name, int len)
+{
+    int arg = -1;
+
+    /*
+     *  Only {value} takes an argument.
+     */
+    for (int i=0; i < len; i++) {
+        if (name[i] == ':') {
+            if (len - i != 2 || name[i+1] < '0' || name[i+1] > '9') {
+                return -EINVAL;
+            }
+            arg = name[i+1] - '0';
+            len = i;
+            break;
+        }
+    }
+
+    for (int i=0; i < ARRAY_SIZE(names); i++) {
+        if (strlen(names[i].name) != len ||
+            strncmp(names[i].name, name, len) != 0) {
+            continue;
+        }
+        if (arg >= 0 && names[i].op != OP_VALUE) {
+            return -EINVAL;
+        }
+        if (names[i].op == OP_KEYS) {
+            return outputEmitKey(c, 0, names[i].code);
+        }
+        if (outputEmitOp(c, names[i].op) != 0) {
+            return -ENOSPC;
+        }
+        if (names[i].op == OP_VALUE) {
+            return outputEmit(c, (arg < 0) ? UINT8_MAX : arg);
+        }
+        return 0;
+    }
+    return -EINVAL;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Compile and, if it is valid, switch to the template.                     */
+/*  Returns -EINVAL for a syntax error, -ENOSPC if it is too long.           */
+/*---------------------------------------------------------------------------*/
+int output_compile(const char * template)
+{
+    uint8_t code [OUTPUT_PROGRAM_SIZE];
+    output_compiler_t c = { .code = code, .length = 0, .keys = -1 };
+    keyboard_key_t key;
+    const char * p = template;
+    int ret = 0;
+
+    if (strlen(template) >= sizeof(template_text)) {
+        return -ENOSPC;
+    }
+
+    while (*p && ret == 0) {
+
+        if (p[0] == '{' && p[1] == '{') {
+            p += 2;
+            ret = keyboard_ascii_key('{', &key);
+        }
+        else if (p[0] == '{') {
+            const char * end = strchr(p, '}');
+
+            if (end == NULL) {
+                ret = -EINVAL;
+                break;
+            }
+            ret = outputCompileName(&c, p + 1, end - p - 1);
+            p = end + 1;
+            continue;
+        }
+        else {
+            ret = keyboard_ascii_key(*p++, &key);
+        }
+
+        if (ret == 0) {
+            ret = outputEmitKey(&c, key.modifier, key.code);
+        }
+    }
+
+    if (ret != 0) {
+        LOG_WRN("%s: bad template at %d: %d", __func__, (int) (p - template), ret);
+        return ret;
+    }
+    code[c.length++] = OP_END;
+
+    k_mutex_lock(&output_mutex, K_FOREVER);
+    memcpy(program, code, c.length);
+    strcpy(template_text, template);
+    k_mutex_unlock(&output_mutex);
+
+    LOG_INF("%s: \"%s\", %d bytes", __func__, template, c.length);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+const char * output_template(void)
+{
+    return template_text;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Renderer state                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    keyboard_key_t * keys;
+    int              size;
+    int              count;
+} output_sink_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputKey(output_sink_t * sink, uint8_t modifier, uint8_t code)
+{
+    if (sink->count >= sink->size) {
+        return -ENOSPC;
+    }
+    sink->keys[sink->count].modifier = modifier;
+    sink->keys[sink->count].code     = code;
+    sink->count++;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputText(output_sink_t * sink, const char * text)
+{
+    keyboard_key_t key;
+
+    for (; *text; text++) {
+        if (keyboard_ascii_key(*text, &key) != 0) {
+            continue;
+        }
+        if (outputKey(sink, key.modifier, key.code) != 0) {
+            return -ENOSPC;
+        }
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputNumber(output_sink_t * sink, uint32_t number)
+{
+    char digits [11];
+    int  i = sizeof(digits) - 1;
+
+    digits[i] = '\0';
+    do {
+        digits[--i] = '0' + (number % 10);
+        number /= 10;
+    } while (number != 0);
+
+    return outputText(sink, &digits[i]);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int outputEol(output_sink_t * sink)
+{
+    if (app_uicr_get_line_end() == NEWLINE) {
+        return outputKey(sink, 0, HID_KEY_ENTER);
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Append one reading's keystrokes.  Returns the number appended, or        */
+/*  -ENOSPC if they did not all fit in size.                                 */
+/*---------------------------------------------------------------------------*/
+int output_render(const output_reading_t * reading,
+                  keyboard_key_t * keys, int size)
+{
+    output_sink_t sink = { .keys = keys, .size = size, .count = 0 };
+    const uint8_t * pc = program;
+    char value [16];
+    int  ret = 0;
+
+    k_mutex_lock(&output_mutex, K_FOREVER);
+
+    while (*pc != OP_END && ret == 0) {
+
+        switch (*pc++) {
+
+            case OP_KEYS:
+                for (int n = *pc++; n > 0 && ret == 0; n--, pc += 2) {
+                    ret = outputKey(&sink, pc[0], pc[1]);
+                }
+                break;
+
+            case OP_VALUE:
+                format_value(value, sizeof(value), reading->value,
+                             reading->standard,
+                             (*pc == UINT8_MAX) ? FORMAT_DECIMALS_DEFAULT : *pc);
+                pc++;
+                ret = outputText(&sink, value);
+                break;
+
+            case OP_UNIT:
+                ret = outputText(&sink, 
+                    (reading->standard == CALIPER_STANDARD_MM) ? "mm" : "inch");
+                break;
+
+            case OP_SUFFIX:
+                if (app_uicr_get_standard() == INCLUDE) {
+                    ret = outputText(&sink,
+                        (reading->standard == CALIPER_STANDARD_MM) ? " mm" : " inch");
+                }
+                break;
+
+            case OP_CHANNEL:
+                ret = outputNumber(&sink, reading->channel);
+                break;
+
+            case OP_SEQ:
+                ret = outputNumber(&sink, reading->seq);
+                break;
+
+            case OP_MS:
+                ret = outputNumber(&sink, 
+                        (uint32_t) k_ticks_to_ms_floor64(reading->timestamp));
+                break;
+
+            case OP_EOL:
+                ret = outputEol(&sink);
+                break;
+
+            case OP_SEP:
+                ret = (reading->last) ? outputEol(&sink) :
+                                        outputKey(&sink, 0, HID_KEY_TAB);
+                break;
+
+            default:
+                ret = -EILSEQ;
+                break;
+        }
+    }
+
+    k_mutex_unlock(&output_mutex);
+
+    return (ret == 0) ? sink.count : ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Append one table row: cells separated by TAB, then ENTER.  Returns the   */
+/*  number of keys appended, or -ENOSPC if they did not all fit in size.     */
+/*---------------------------------------------------------------------------*/
+int output_cells(const char * const * cells, int count,
+                 keyboard_key_t * keys, int size)
+{
+    output_sink_t sink = { .keys = keys, .size = size, .count = 0 };
+    int ret = 0;
+
+    for (int i=0; i < count && ret == 0; i++) {
+        if (i > 0) {
+            ret = outputKey(&sink, 0, HID_KEY_TAB);
+        }
+        if (ret == 0) {
+            ret = outputText(&sink, cells[i]);
+        }
+    }
+    if (ret == 0) {
+        ret = outputKey(&sink, 0, HID_KEY_ENTER);
+    }
+
+    return (ret == 0) ? sink.count : ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void output_init(void)
+{
+    LOG_INF("%s", __func__);
+
+    if (output_compile(CONFIG_CALIPER_OUTPUT_TEMPLATE) != 0) {
+        LOG_ERR("CALIPER_OUTPUT_TEMPLATE is not valid, using the default");
+        output_compile("{value}{suffix}{sep}");
+    }
+}
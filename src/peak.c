@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  peak.c  -- Peak, valley and TIR hold
+ *
+ *  From peak_arm() to peak_disarm() each channel keeps only the min and
+ *  max of its readings, so a hold can run for any length of time at the
+ *  full frame rate.  Readings arrive datum relative but unfiltered: a
+ *  filter would pull the extremes in.  Readings in the other standard
+ *  are converted to the channel's first one.  On disarm the selected
+ *  statistic -- max (peak), min (valley) or max - min (TIR) -- goes to
+ *  the notify handler as one reading per channel.
+ *
+ *  A hold is only as good as its coverage: every frame the caliper sent
+ *  while armed that did not reach the hold (undecoded, or rejected by
+ *  validation) is counted as dropped, from the readings ring statistics.
+ */
+#include <zephyr/kernel.h>
+#include <errno.h>
+
+#include "peak.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+#include "units.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(peak, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#if defined(CONFIG_CALIPER_PEAK_DEFAULT_MIN)
+#define PEAK_MODE_DEFAULT   PEAK_MIN
+#elif defined(CONFIG_CALIPER_PEAK_DEFAULT_TIR)
+#define PEAK_MODE_DEFAULT   PEAK_TIR
+#else
+#define PEAK_MODE_DEFAULT   PEAK_MAX
+#endif
+
+static void peakNotify(struct k_work * work);
+
+K_WORK_DEFINE(peak_work, peakNotify);
+
+static peak_notify_t notify_handler = NULL;
+
+typedef struct {
+    bool         have;
+    peak_hold_t  hold;
+    uint32_t     frames_base;     // readings_get_stats() when armed
+    uint32_t     dropped_base;
+} peak_channel_t;
+
+static peak_channel_t channels [CALIPER_CHANNELS];
+
+static struct {
+    bool         armed;
+    peak_mode_t  mode;
+    int32_t      values [CALIPER_CHANNELS];     // handed to the notify handler
+    int          standards [CALIPER_CHANNELS];
+} peak = {
+    .mode = PEAK_MODE_DEFAULT,
+};
+
+static struct k_spinlock peak_lock;
+
+static const char * const mode_names [] = {
+    [PEAK_MAX] = "max",
+    [PEAK_MIN] = "min",
+    [PEAK_TIR] = "tir",
+};
+
+/*---------------------------------------------------------------------------*/
+/*  Caliper thread, after each good reading: widen the extremes.             */
+/*---------------------------------------------------------------------------*/
+void peak_reading(const caliper_reading_t * reading)
+{
+    peak_channel_t * ch = &channels[reading->channel];
+    int32_t value = reading->value;
+    k_spinlock_key_t key = k_spin_lock(&peak_lock);
+
+    if (peak.armed) {
+        if (!ch->have) {
+            ch->have          = true;
+            ch->hold.standard = reading->standard;
+            ch->hold.min      = value;
+            ch->hold.max      = value;
+        }
+        else {
+            if (reading->standard != ch->hold.standard) {
+                value = units_convert(value, reading->standard,
+                                      ch->hold.standard);
+            }
+            ch->hold.min = MIN(ch->hold.min, value);
+            ch->hold.max = MAX(ch->hold.max, value);
+        }
+        ch->hold.frames++;
+    }
+
+    k_spin_unlock(&peak_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Frames the caliper sent since arming that the hold has not seen, given   */
+/*  the readings statistics now.  Under peak_lock.                           */
+/*---------------------------------------------------------------------------*/
+static void peakCoverage(const readings_stats_t * stats)
+{
+    uint32_t sent;
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        sent = (stats[i].frames - channels[i].frames_base) +
+               (stats[i].dropped - channels[i].dropped_base);
+        channels[i].hold.dropped = (sent > channels[i].hold.frames) ?
+                                   sent - channels[i].hold.frames : 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void peakReadingsStats(readings_stats_t * stats)
+{
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        readings_get_stats(i, &stats[i]);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start a hold; -EALREADY if one is running.                               */
+/*---------------------------------------------------------------------------*/
+int peak_arm(void)
+{
+    readings_stats_t stats [CALIPER_CHANNELS];
+    k_spinlock_key_t key;
+
+    peakReadingsStats(stats);
+
+    key = k_spin_lock(&peak_lock);
+
+    if (peak.armed) {
+        k_spin_unlock(&peak_lock, key);
+        return -EALREADY;
+    }
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        channels[i].have         = false;
+        channels[i].hold.frames  = 0;
+        channels[i].hold.dropped = 0;
+        channels[i].frames_base  = stats[i].frames;
+        channels[i].dropped_base = stats[i].dropped;
+    }
+    peak.armed = true;
+
+    k_spin_unlock(&peak_lock, key);
+
+    LOG_INF("%s: %s", __func__, mode_names[peak.mode]);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  End the hold and hand on the selected statistic.  -EALREADY if none was  */
+/*  running, -ENODATA if a channel saw no readings.                          */
+/*---------------------------------------------------------------------------*/
+int peak_disarm(void)
+{
+    readings_stats_t stats [CALIPER_CHANNELS];
+    const peak_hold_t * hold;
+    int ret = 0;
+    k_spinlock_key_t key;
+
+    peakReadingsStats(stats);
+
+    key = k_spin_lock(&peak_lock);
+
+    if (!peak.armed) {
+        k_spin_unlock(&peak_lock, key);
+        return -EALREADY;
+    }
+    peak.armed = false;
+
+    peakCoverage(stats);
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        if (!channels[i].have) {
+            ret = -ENODATA;
+            continue;
+        }
+        hold = &channels[i].hold;
+
+        switch (peak.mode) {
+            case PEAK_MIN: peak.values[i] = hold->min;             break;
+            case PEAK_TIR: peak.values[i] = hold->max - hold->min; break;
+            default:       peak.values[i] = hold->max;             break;
+        }
+        peak.standards[i] = hold->standard;
+    }
+
+    k_spin_unlock(&peak_lock, key);
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+        if (channels[i].hold.dropped > 0) {
+            LOG_WRN("%s: %d %u frames, %u dropped", __func__, i,
+                    channels[i].hold.frames, channels[i].hold.dropped);
+        }
+        else {
+            LOG_INF("%s: %d %u frames, none dropped", __func__, i,
+                    channels[i].hold.frames);
+        }
+    }
+
+    if (ret == 0) {
+        k_work_submit(&peak_work);
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool peak_armed(void)
+{
+    return peak.armed;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The running hold, or the last one; -ENODATA if it has no readings.       */
+/*---------------------------------------------------------------------------*/
+int peak_get(int channel, peak_hold_t * hold)
+{
+    readings_stats_t stats [CALIPER_CHANNELS];
+    int ret = 0;
+    k_spinlock_key_t key;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+
+    peakReadingsStats(stats);
+
+    key = k_spin_lock(&peak_lock);
+
+    if (peak.armed) {
+        peakCoverage(stats);
+    }
+
+    *hold = channels[channel].hold;
+    if (!channels[channel].have) {
+        ret = -ENODATA;
+    }
+
+    k_spin_unlock(&peak_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void peakNotify(struct k_work * work)
+{
+    LOG_INF("%s: %s", __func__, mode_names[peak.mode]);
+
+    if (notify_handler) {
+        notify_handler(peak.values, peak.standards);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Statistic handed on at disarm; may change while armed.                   */
+/*---------------------------------------------------------------------------*/
+void peak_set_mode(peak_mode_t mode)
+{
+    peak.mode = mode;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+peak_mode_t peak_get_mode(void)
+{
+    return peak.mode;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+const char * peak_mode_name(peak_mode_t mode)
+{
+    if ((unsigned) mode >= ARRAY_SIZE(mode_names)) {
+        return NULL;
+    }
+    return mode_names[mode];
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void peak_register_notify_handler(peak_notify_t notify)
+{
+    notify_handler = notify;
+}
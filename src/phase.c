@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  phase.c  -- Caliper frame phase tracker
+ *
+ *  The caliper emits frames at a steady period, so once two frame starts
+ *  have been seen the next one can be predicted.  The framer then only
+ *  sleeps until just before the predicted start, instead of re-running
+ *  the gap search on every read.  Every prediction is checked against
+ *  the frame start actually seen; a miss (rate change, caliper power
+ *  cycled) drops the lock and the next read searches for the gap again.
+ */
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+
+#include "phase.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(phase, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define PHASE_MIN_PERIOD_US     10000
+#define PHASE_MAX_PERIOD_US     500000
+
+/* Arm this long before the predicted start: well inside the gap. */
+#define PHASE_MARGIN_US         CONFIG_CALIPER_PHASE_MARGIN_US
+
+/* Don't extrapolate an unconfirmed lock forever. */
+#define PHASE_HOLD_US           (CONFIG_CALIPER_PHASE_HOLD_MS * 1000LL)
+
+typedef struct {
+    phase_stats_t  stats;
+    int64_t        last_start;   // usecs, last confirmed frame start
+    int64_t        pending_end;  // usecs, frame end seen by the framer
+    int64_t        predicted;    // usecs, start the read was armed for
+} phase_t;
+
+static phase_t phase;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int64_t phase_now_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void phase_unlock(void)
+{
+    if (phase.stats.locked) {
+        LOG_INF("%s", __func__);
+    }
+
+    phase.stats.locked = false;
+    phase.last_start   = 0;
+    phase.predicted    = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Fold one observed frame start into the period estimate.                  */
+/*---------------------------------------------------------------------------*/
+static void phaseMeasure(int64_t start)
+{
+    int64_t delta;
+    int64_t error;
+    int64_t frames;
+
+    if (phase.last_start == 0) {
+        phase.last_start = start;
+        return;
+    }
+
+    delta = start - phase.last_start;
+    phase.last_start = start;
+
+    if (!phase.stats.locked) {
+        if (delta >= PHASE_MIN_PERIOD_US && delta <= PHASE_MAX_PERIOD_US) {
+            phase.stats.period = delta;
+            phase.stats.jitter = 0;
+            phase.stats.locked = true;
+            phase.stats.locks++;
+            LOG_INF("locked: period %u us", phase.stats.period);
+        }
+        return;
+    }
+
+    /*
+     *  Reads are sporadic: several frames may have gone by unseen.
+     */
+    frames = (delta + phase.stats.period / 2) / phase.stats.period;
+    if (frames == 0) {
+        phase_unlock();
+        return;
+    }
+
+    error = delta - frames * phase.stats.period;
+
+    if (llabs(error) > phase.stats.period / 4) {
+        LOG_INF("rate changed: error %d us", (int) error);
+        phase_unlock();
+        phase.last_start = start;
+        return;
+    }
+
+    /*
+     *  Drift correction: average period over the frames seen,
+     *  smoothed 1/4; jitter is the smoothed absolute phase error.
+     */
+    phase.stats.period += (int32_t)(delta / frames - phase.stats.period) / 4;
+    phase.stats.jitter += ((int32_t) llabs(error) - 
+                           (int32_t) phase.stats.jitter) / 4;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Framer found a gap at 'end': the frame before it ends there.             */
+/*---------------------------------------------------------------------------*/
+void phase_frame_end(int64_t end)
+{
+    phase.pending_end = end;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A whole frame was captured.  Returns false if it did not start where     */
+/*  predicted, i.e. the capture was armed mid-frame and must be discarded.   */
+/*---------------------------------------------------------------------------*/
+bool phase_frame(int64_t start, int64_t end)
+{
+    int64_t predicted = phase.predicted;
+
+    phase.predicted = 0;
+
+    if (end > start) {
+        if (phase.stats.duration == 0) 
+            phase.stats.duration = end - start;
+        else
+            phase.stats.duration += ((int32_t)(end - start) - 
+                                     (int32_t) phase.stats.duration) / 4;
+    }
+
+    if (predicted != 0 && llabs(start - predicted) > PHASE_MARGIN_US) {
+        LOG_WRN("missed prediction by %d us", (int)(start - predicted));
+        phase.stats.misses++;
+        phase_unlock();
+        return false;
+    }
+
+    /*
+     *  The frame the framer saw go by gives a second start for free.
+     */
+    if (phase.pending_end != 0) {
+        phaseMeasure(phase.pending_end - phase.stats.duration);
+        phase.pending_end = 0;
+    }
+
+    phaseMeasure(start);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  When locked, return the time to arm for the next frame start.            */
+/*---------------------------------------------------------------------------*/
+int phase_predict(int64_t * arm)
+{
+    int64_t now = phase_now_us();
+    int64_t frames;
+
+    if (!phase.stats.locked) {
+        return -EAGAIN;
+    }
+
+    if (now - phase.last_start > PHASE_HOLD_US) {
+        phase_unlock();
+        return -EAGAIN;
+    }
+
+    /*
+     *  First start at least one margin from now.
+     */
+    frames = (now + PHASE_MARGIN_US - phase.last_start) / 
+              phase.stats.period + 1;
+
+    phase.predicted = phase.last_start + frames * phase.stats.period;
+
+    *arm = phase.predicted - PHASE_MARGIN_US;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool phase_is_locked(void)
+{
+    return phase.stats.locked;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void phase_get_stats(phase_stats_t * stats)
+{
+    *stats = phase.stats;
+}
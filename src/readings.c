@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  readings.c  -- Ring buffer of decoded caliper frames
+ *
+ *  In continuous mode the caliper thread decodes every frame the caliper
+ *  emits and puts it here; a snapshot can then be answered from the
+ *  newest record instead of waiting for alignment plus a whole frame.
+ *  Records from all caliper channels share the ring; the newest record
+ *  and the frame period are also kept per channel.
+ */
+#include <zephyr/kernel.h>
+
+#include "readings.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(readings, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define READINGS_COUNT   CONFIG_CALIPER_HISTORY_SIZE
+
+/* Frames further apart than this are not consecutive (caliper was off). */
+#define READINGS_MAX_PERIOD_US   500000
+
+static struct k_spinlock readings_lock;
+
+static caliper_reading_t ring [READINGS_COUNT];
+static uint32_t          head;         // total records put
+
+typedef struct {
+    caliper_reading_t  latest;
+    bool               have_latest;
+    uint32_t           frame_period;  // usecs, smoothed; 0 = unknown
+    uint32_t           frames;
+    uint32_t           dropped;
+} readings_channel_t;
+
+static readings_channel_t channels [CALIPER_CHANNELS];
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void readings_put(const caliper_reading_t * reading)
+{
+    readings_channel_t * ch = &channels[reading->channel];
+    k_spinlock_key_t key = k_spin_lock(&readings_lock);
+
+    if (ch->have_latest) {
+        uint32_t delta = k_ticks_to_us_floor32(reading->timestamp - 
+                                               ch->latest.timestamp);
+
+        if (delta < READINGS_MAX_PERIOD_US) {
+            uint32_t period = ch->frame_period;
+            uint32_t frames;
+
+            if (period == 0 || delta < (period * 3) / 4) {
+                ch->frame_period = delta;   // first, or caliper sped up
+            }
+            else {
+                /*
+                 *  Whole periods apart: frames went by undecoded.
+                 *  Only in continuous mode is every frame expected.
+                 */
+                frames = (delta + period / 2) / period;
+                if (IS_ENABLED(CONFIG_CALIPER_CONTINUOUS)) {
+                    ch->dropped += frames - 1;
+                }
+                delta /= frames;
+
+                ch->frame_period += ((int32_t)delta - (int32_t)period) / 4;
+            }
+        }
+        else {
+            ch->frame_period = 0;   // restart measurement
+        }
+    }
+
+    ch->latest      = *reading;
+    ch->have_latest = true;
+    ch->frames++;
+
+    ring[head % READINGS_COUNT] = *reading;
+    head++;
+
+    k_spin_unlock(&readings_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int readings_latest(int channel, caliper_reading_t * reading)
+{
+    int ret = -ENODATA;
+    k_spinlock_key_t key = k_spin_lock(&readings_lock);
+
+    if (channels[channel].have_latest) {
+        *reading = channels[channel].latest;
+        ret = 0;
+    }
+
+    k_spin_unlock(&readings_lock, key);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Copy up to count most recent records, newest first.                      */
+/*---------------------------------------------------------------------------*/
+int readings_history(caliper_reading_t * readings, int count)
+{
+    int i;
+    k_spinlock_key_t key = k_spin_lock(&readings_lock);
+
+    count = MIN(count, MIN(head, READINGS_COUNT));
+
+    for (i=0; i < count; i++) {
+        readings[i] = ring[(head - 1 - i) % READINGS_COUNT];
+    }
+
+    k_spin_unlock(&readings_lock, key);
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+uint32_t readings_frame_period_us(int channel)
+{
+    return channels[channel].frame_period;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void readings_get_stats(int channel, readings_stats_t * stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&readings_lock);
+
+    stats->frames       = channels[channel].frames;
+    stats->dropped      = channels[channel].dropped;
+    stats->frame_period = channels[channel].frame_period;
+
+    k_spin_unlock(&readings_lock, key);
+}
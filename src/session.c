@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  session.c  -- Batch session: store captures, type them as a table
+ *
+ *  While the session is on, captured readings are stored instead of
+ *  typed, one cell per channel, filling a row of session_columns() cells
+ *  before moving to the next; session_next_row() starts the next row
+ *  early (say, for the next part).  session_type() then types the whole
+ *  table, cells separated by TAB and rows ended by ENTER, rendered a row
+ *  at a time into the keyboard queue so the link is never left idle, and
+ *  reports how long it took.
+ *
+ *  With CONFIG_CALIPER_SESSION_PERSIST each cell is also kept in
+ *  settings ("session/<n>", "session/count"), so a session survives a
+ *  reboot or a flat battery.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "session.h"
+#include "caliper.h"
+#include "keyboard.h"
+#include "output.h"
+#include "format.h"
+#include "ble_base.h"
+#include "store.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(session, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define SESSION_SIZE      CONFIG_CALIPER_SESSION_SIZE
+
+/* Keystrokes for one row: every cell at its longest, plus separators. */
+#define SESSION_ROW_KEYS  (SESSION_COLUMNS_MAX * 16)
+
+/* The last row can take this long to go out. */
+#define SESSION_DRAIN     K_SECONDS(30)
+
+static session_cell_t cells [SESSION_SIZE];
+
+static int count;
+static int columns = CONFIG_CALIPER_SESSION_COLUMNS;
+
+/* Where the next reading goes */
+static uint16_t row;
+static uint8_t  column;
+
+static bool enabled;
+
+K_MUTEX_DEFINE(session_mutex);
+
+#if defined(CONFIG_CALIPER_SESSION_PERSIST)
+/*---------------------------------------------------------------------------*/
+/*  Settings: "session/count" and "session/<n>".                             */
+/*---------------------------------------------------------------------------*/
+static const store_table_t session_store = {
+    .subtree    = "session",
+    .scalar     = "count",
+    .value      = &count,
+    .items      = cells,
+    .item_size  = sizeof(cells[0]),
+    .item_count = SESSION_SIZE,
+};
+
+static int sessionSettingsSet(const char * name, size_t len,
+                              settings_read_cb read_cb, void * cb_arg)
+{
+    return store_table_set(&session_store, name, len, read_cb, cb_arg);
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(session, "session", NULL, sessionSettingsSet,
+                               NULL, NULL);
+
+/*---------------------------------------------------------------------------*/
+/*  Cells first, then the count that makes them part of the session.         */
+/*---------------------------------------------------------------------------*/
+static int sessionSave(int first, int last)
+{
+    char name [16];
+    int ret = 0;
+
+    for (int n=first; n < last && ret == 0; n++) {
+        snprintf(name, sizeof(name), "session/%d", n);
+        ret = settings_save_one(name, &cells[n], sizeof(cells[n]));
+    }
+    if (ret == 0) {
+        ret = settings_save_one("session/count", &count, sizeof(count));
+    }
+    if (ret != 0) {
+        LOG_ERR("%s: failed: %d", __func__, ret);
+    }
+    return ret;
+}
+#endif
+
+/*---------------------------------------------------------------------------*/
+/*  Under session_mutex.                                                     */
+/*---------------------------------------------------------------------------*/
+static void sessionNextRow(void)
+{
+    if (column != 0) {
+        column = 0;
+        row++;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Store one reading per channel at the next cells.  -ENOSPC, storing       */
+/*  nothing, if they do not all fit.                                         */
+/*---------------------------------------------------------------------------*/
+int session_put(const int32_t * values, const int * standards, int number)
+{
+    int first;
+
+    k_mutex_lock(&session_mutex, K_FOREVER);
+
+    if (count + number > SESSION_SIZE) {
+        k_mutex_unlock(&session_mutex);
+        return -ENOSPC;
+    }
+
+    first = count;
+
+    for (int i=0; i < number; i++) {
+        cells[count].value    = values[i];
+        cells[count].standard = standards[i];
+        cells[count].row      = row;
+        cells[count].column   = column;
+        count++;
+
+        if (++column >= columns) {
+            sessionNextRow();
+        }
+    }
+
+#if defined(CONFIG_CALIPER_SESSION_PERSIST)
+    sessionSave(first, count);
+#else
+    ARG_UNUSED(first);
+#endif
+
+    k_mutex_unlock(&session_mutex);
+
+    LOG_INF("%s: %d cells", __func__, count);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The next reading starts a new row (unless the row is still empty).       */
+/*---------------------------------------------------------------------------*/
+void session_next_row(void)
+{
+    k_mutex_lock(&session_mutex, K_FOREVER);
+    sessionNextRow();
+    k_mutex_unlock(&session_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Cells per row, from the next reading on.                                 */
+/*---------------------------------------------------------------------------*/
+int session_set_columns(int number)
+{
+    if (number < 1 || number > SESSION_COLUMNS_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&session_mutex, K_FOREVER);
+
+    columns = number;
+    if (column >= columns) {
+        sessionNextRow();
+    }
+
+    k_mutex_unlock(&session_mutex);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int session_columns(void)
+{
+    return columns;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int session_count(void)
+{
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Cell n, in the order stored; -ENOENT past the end.                       */
+/*---------------------------------------------------------------------------*/
+int session_get(int n, session_cell_t * cell)
+{
+    int ret = -ENOENT;
+
+    k_mutex_lock(&session_mutex, K_FOREVER);
+
+    if (n >= 0 && n < count) {
+        *cell = cells[n];
+        ret = 0;
+    }
+
+    k_mutex_unlock(&session_mutex);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void session_clear(void)
+{
+    k_mutex_lock(&session_mutex, K_FOREVER);
+
+    count  = 0;
+    row    = 0;
+    column = 0;
+
+#if defined(CONFIG_CALIPER_SESSION_PERSIST)
+    sessionSave(0, 0);
+#endif
+
+    k_mutex_unlock(&session_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Captures are stored, not typed, while enabled.                           */
+/*---------------------------------------------------------------------------*/
+void session_enable(bool enable)
+{
+    enabled = enable;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool session_enabled(void)
+{
+    return enabled;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The row starting at cell *next, as text; advances *next past it.         */
+/*  Returns the number of cells up to the last one filled, 0 at the end.     */
+/*---------------------------------------------------------------------------*/
+static int sessionRow(int * next, char text [][16], const char ** row_cells)
+{
+    const session_cell_t * cell;
+    int width = 0;
+    int n = *next;
+
+    k_mutex_lock(&session_mutex, K_FOREVER);
+
+    while (n < count && cells[n].row == cells[*next].row) {
+        cell = &cells[n++];
+        if (cell->column >= SESSION_COLUMNS_MAX) {
+            continue;
+        }
+        for (; width <= cell->column; width++) {
+            text[width][0] = '\0';
+            row_cells[width] = text[width];
+        }
+        format_value(text[cell->column], sizeof(text[0]), cell->value,
+                     cell->standard, FORMAT_DECIMALS_DEFAULT);
+    }
+
+    k_mutex_unlock(&session_mutex);
+
+    *next = n;
+
+    return width;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Type the session as a table.  Rows are queued as they are rendered;      */
+/*  returns once the last is typed, with the keystroke count and time.       */
+/*---------------------------------------------------------------------------*/
+int session_type(session_report_t * report)
+{
+    static keyboard_key_t keys [SESSION_ROW_KEYS];
+    static char text [SESSION_COLUMNS_MAX][16];
+    const char * row_cells [SESSION_COLUMNS_MAX];
+    int64_t start;
+    int next = 0;
+    int width;
+    int length;
+    int ret;
+
+    if (is_bt_connected() == false) {
+        return -ENOTCONN;
+    }
+    if (count == 0) {
+        return -ENODATA;
+    }
+
+    report->keys = 0;
+    start = k_uptime_get();
+
+    while ((width = sessionRow(&next, text, row_cells)) > 0) {
+
+        length = output_cells(row_cells, width, keys, ARRAY_SIZE(keys));
+        if (length < 0) {
+            LOG_WRN("%s: row not rendered (%d)", __func__, length);
+            continue;
+        }
+
+        ret = keyboard_queue_keys(keys, length, KEYBOARD_QUEUE_STALL);
+        if (ret < length) {
+            keyboard_queue_flush();
+            LOG_WRN("%s: keyboard stalled", __func__);
+            return (ret < 0) ? ret : -EIO;
+        }
+        report->keys += length;
+    }
+
+    ret = keyboard_queue_drain(SESSION_DRAIN);
+
+    report->ms = (uint32_t)(k_uptime_get() - start);
+
+    LOG_INF("%s: %u keys in %u ms", __func__, report->keys, report->ms);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Reload a kept session; new readings go on a new row.                     */
+/*---------------------------------------------------------------------------*/
+void session_init(void)
+{
+#if defined(CONFIG_CALIPER_SESSION_PERSIST)
+    store_table_load(&session_store);
+
+    if (count < 0 || count > SESSION_SIZE) {
+        count = 0;
+    }
+    if (count > 0) {
+        row    = cells[count - 1].row + 1;
+        column = 0;
+    }
+#endif
+
+    LOG_INF("%s: %d cells of %d", __func__, count, SESSION_SIZE);
+}
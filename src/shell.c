@@ -6,6 +6,10 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/drivers/uart.h>
@@ -21,6 +25,24 @@
 #include "caliper.h"
 #include "battery.h"
 #include "buttons.h"
+#include "readings.h"
+#include "phase.h"
+#include "decoder.h"
+#include "caliper_gpio.h"
+#include "activity.h"
+#include "sigmon.h"
+#include "validate.h"
+#include "autocap.h"
+#include "format.h"
+#include "output.h"
+#include "units.h"
+#include "stats.h"
+#include "filter.h"
+#include "tolerance.h"
+#include "datum.h"
+#include "burst.h"
+#include "session.h"
+#include "peak.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(app_shell, LOG_LEVEL_INF);
@@ -32,6 +54,19 @@ LOG_MODULE_REGISTER(app_shell, LOG_LEVEL_INF);
 static const struct device * const device =
                   DEVICE_DT_GET_OR_NULL(DT_NODELABEL(uart0));
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static const char * unitsName(units_t units)
+{
+    switch (units) {
+        case AS_CALIPER:  return "caliper";
+        case ALWAYS_MM:   return "mm";
+        case ALWAYS_INCH: return "inch";
+        default:          return "<unknown>";
+    }
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -43,8 +78,16 @@ static int cmd_shell_info(const struct shell *sh, size_t argc, char *argv[])
     char * line_end;
     char * standard;
     int8_t level;
+    caliper_latest_t latest;
+    char value[16];
 
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    activity_stats_t activity;
+
+    activity_get_stats(&activity);
+#else
     framer_find_interframe_gap();
+#endif
 
     switch (app_uicr_get_line_end()) { 
         case ASCIIZ:  line_end = "ASCIIZ";    break;
@@ -62,6 +105,23 @@ static int cmd_shell_info(const struct shell *sh, size_t argc, char *argv[])
     shell_print(sh, "** Built on %s at %s", __DATE__, __TIME__);
     shell_print(sh, "** Board '%s'", CONFIG_BOARD);
     shell_print(sh, "** Caliper %s", is_caliper_on()?"ON":"OFF");
+#if defined(CONFIG_CALIPER_ACTIVITY)
+    shell_print(sh, "** Clock edges: %u (last period %u, %u transitions)",
+                activity.edges, activity.last_edges, activity.transitions);
+#endif
+    for (int ch=0; ch < caliper_channel_count(); ch++) {
+        if (caliper_latest(ch, &latest, NULL) != 0) {
+            continue;
+        }
+        format_value(value, sizeof(value), latest.value, latest.standard,
+                     FORMAT_DECIMALS_ALL);
+        shell_print(sh, "** Channel %d latest: %s %s, %u ms ago (seq %u)",
+                    ch, value,
+                    latest.standard == CALIPER_STANDARD_MM ? "mm" : "inch",
+                    (uint32_t) k_ticks_to_ms_floor64(k_uptime_ticks() -
+                                                     latest.timestamp),
+                    latest.seq);
+    }
     shell_print(sh, "** BLE connected: %s", is_bt_connected()?"yes":"no");
 
     level = bt_bas_get_battery_level();
@@ -73,6 +133,8 @@ static int cmd_shell_info(const struct shell *sh, size_t argc, char *argv[])
     shell_print(sh, "** Parameters --");
     shell_print(sh, "**   [line_end] %s", line_end);
     shell_print(sh, "**   [standard] %s", standard);
+    shell_print(sh, "**   [units]    %s", unitsName(units_get_policy()));
+    shell_print(sh, "**   [template] %s", output_template());
 
     return 0;
 }
@@ -92,6 +154,750 @@ static int cmd_shell_snap(const struct shell *sh, size_t argc, char *argv[])
     return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_history(const struct shell *sh, size_t argc, char *argv[])
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    caliper_reading_t readings[CONFIG_CALIPER_HISTORY_SIZE];
+    readings_stats_t stats;
+    uint32_t period;
+    char value[16];
+    int count;
+
+    count = readings_history(readings, ARRAY_SIZE(readings));
+
+    for (int ch=0; ch < CALIPER_CHANNELS; ch++) {
+        readings_get_stats(ch, &stats);
+        period = framer_frame_period_us(ch);
+
+        shell_print(sh, "channel %d frame period: %u us (%u.%u fps), "
+                    "gap threshold %u us",
+                    ch, period,
+                    (period) ? 1000000 / period : 0,
+                    (period) ? (10000000 / period) % 10 : 0,
+                    framer_gap_us(ch));
+        shell_print(sh, "channel %d frames: %u decoded, %u dropped",
+                    ch, stats.frames, stats.dropped);
+    }
+
+    for (int i=0; i < count; i++) {
+        format_value(value, sizeof(value), readings[i].value,
+                     readings[i].standard, FORMAT_DECIMALS_ALL);
+        shell_print(sh, "%8u ms  ch%u  %10s  %s  0x%02x",
+                    (uint32_t) k_ticks_to_ms_floor64(readings[i].timestamp),
+                    readings[i].channel,
+                    value,
+                    (readings[i].standard == CALIPER_STANDARD_MM) ? "mm  " : "inch",
+                    readings[i].flags);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_protocol(const struct shell *sh, size_t argc, char *argv[])
+{
+    const caliper_decoder_t * decoder;
+    decoder_stats_t stats;
+    int channel = 0;
+
+    if (argc > 2) {
+        channel = atoi(argv[2]);
+        if (channel < 0 || channel >= CALIPER_CHANNELS) {
+            shell_error(sh, "no channel %s", argv[2]);
+            return -EINVAL;
+        }
+    }
+
+    if (argc > 1) {
+        if (decoder_select(channel, argv[1]) != 0) {
+            shell_error(sh, "unknown protocol: %s", argv[1]);
+            return -ENOENT;
+        }
+#if defined(CONFIG_CALIPER_VALIDATE)
+        validate_reset(channel);
+#endif
+    }
+
+    for (int ch=0; ch < CALIPER_CHANNELS; ch++) {
+        shell_print(sh, "channel %d protocol: %s  %u us/bit  units at %u us",
+                    ch, decoder_name(ch), decoder_bit_period_us(ch),
+                    decoder_units_delay_us(ch));
+    }
+
+    for (int i=0; i < decoder_count(); i++) {
+        decoder = decoder_get(i, &stats);
+        shell_print(sh, "  %-10s %2u bits  %4u-%-4u us  %s  "
+                    "decodes %u  errors %u  last %u ns  max %u ns",
+                    decoder->name, decoder->bits,
+                    decoder->bit_min_us, decoder->bit_max_us,
+                    (decoder->detect) ? "auto" : "    ",
+                    stats.decodes, stats.errors,
+                    stats.last_ns, stats.max_ns);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_bench(const struct shell *sh, size_t argc, char *argv[])
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    const caliper_decoder_t * decoder;
+    uint32_t ns;
+    int ret;
+
+    for (int i=0; i < decoder_count(); i++) {
+        decoder = decoder_get(i, NULL);
+        ret = decoder_benchmark(i, 10000, &ns);
+        shell_print(sh, "  %-10s %u ns/frame%s",
+                    decoder->name, ns, (ret != 0) ? "  (decode failed)" : "");
+    }
+
+    return 0;
+}
+
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_phase(const struct shell *sh, size_t argc, char *argv[])
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    phase_stats_t stats;
+
+    phase_get_stats(&stats);
+
+    shell_print(sh, "locked:   %s", (stats.locked) ? "yes" : "no");
+    shell_print(sh, "period:   %u us", stats.period);
+    shell_print(sh, "jitter:   %u us", stats.jitter);
+    shell_print(sh, "duration: %u us", stats.duration);
+    shell_print(sh, "locks:    %u", stats.locks);
+    shell_print(sh, "misses:   %u", stats.misses);
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_signal(const struct shell *sh, size_t argc, char *argv[])
+{
+    static const char * const names [SIGMON_HISTOGRAMS] = {
+        "low", "high", "period", "gap",
+    };
+
+    sigmon_stats_t stats;
+    sigmon_frame_t frames[CONFIG_CALIPER_SIGNAL_FRAMES];
+    char line[8 + SIGMON_BINS * 6];
+    int count;
+    int len;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            shell_error(sh, "usage: caliper signal [reset]");
+            return -EINVAL;
+        }
+        sigmon_reset();
+        return 0;
+    }
+
+    len = snprintf(line, sizeof(line), "%-7s", "us >=");
+    for (int bin=0; bin < SIGMON_BINS; bin++) {
+        len += snprintf(&line[len], sizeof(line) - len, " %5u", 1u << bin);
+    }
+
+    for (int ch=0; ch < CALIPER_CHANNELS; ch++) {
+
+        sigmon_get_stats(ch, &stats);
+
+        shell_print(sh, "channel %d: frames %u  bad %u  glitches %u  short %u",
+                    ch, stats.frames, stats.bad_frames,
+                    stats.glitches, stats.short_pulses);
+        shell_print(sh, "%s", line);
+
+        for (int h=0; h < SIGMON_HISTOGRAMS; h++) {
+            char row[sizeof(line)];
+            int  n = snprintf(row, sizeof(row), "%-7s", names[h]);
+
+            for (int bin=0; bin < SIGMON_BINS; bin++) {
+                n += snprintf(&row[n], sizeof(row) - n, " %5u",
+                              stats.bins[h][bin]);
+            }
+            shell_print(sh, "%s", row);
+        }
+    }
+
+    count = sigmon_frames(frames, ARRAY_SIZE(frames));
+
+    for (int i=0; i < count; i++) {
+        shell_print(sh, "%8u ms  ch%u  %2u bits  0x%016llx  units %2d  %5u us  %d",
+                    (uint32_t) k_ticks_to_ms_floor64(frames[i].timestamp),
+                    frames[i].channel, frames[i].frame.bits,
+                    (unsigned long long) frames[i].frame.data,
+                    frames[i].frame.units, frames[i].frame.duration,
+                    frames[i].status);
+    }
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_AUTO_CAPTURE)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_auto(const struct shell *sh, size_t argc, char *argv[])
+{
+    autocap_stats_t stats;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "on") == 0) {
+            autocap_enable(true);
+        }
+        else if (strcmp(argv[1], "off") == 0) {
+            autocap_enable(false);
+        }
+        else {
+            shell_error(sh, "usage: caliper auto [on|off]");
+            return -EINVAL;
+        }
+    }
+
+    autocap_get_stats(&stats);
+
+    shell_print(sh, "auto-capture %s, %s, %u captures",
+                (stats.enabled) ? "on" : "off",
+                (stats.armed) ? "armed" : "waiting for movement",
+                stats.captures);
+    shell_print(sh, "deadband %d um, dwell %d ms",
+                CONFIG_CALIPER_AUTO_CAPTURE_DEADBAND,
+                CONFIG_CALIPER_AUTO_CAPTURE_DWELL_MS);
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_FILTER)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_filter(const struct shell *sh, size_t argc, char *argv[])
+{
+    filter_stats_t stats;
+    const char * name;
+    int mode;
+
+    if (argc > 2 && strcmp(argv[1], "average") == 0 &&
+        (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        filter_set_average(strcmp(argv[2], "on") == 0);
+    }
+    else if (argc == 2) {
+        for (mode=0; (name = filter_mode_name(mode)) != NULL; mode++) {
+            if (strcmp(argv[1], name) == 0) {
+                break;
+            }
+        }
+        if (name == NULL) {
+            shell_error(sh, "usage: caliper filter "
+                        "[off|median|iir|kalman|average on|off]");
+            return -EINVAL;
+        }
+        filter_set_mode(mode);
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper filter "
+                    "[off|median|iir|kalman|average on|off]");
+        return -EINVAL;
+    }
+
+    shell_print(sh, "filter %s, N %d, averaged snapshot %s",
+                filter_mode_name(filter_get_mode()), CONFIG_CALIPER_FILTER_N,
+                filter_average_enabled() ? "on" : "off");
+
+    for (int ch=0; ch < caliper_channel_count(); ch++) {
+        filter_get_stats(ch, &stats);
+        shell_print(sh, "%d: %u frames, %u restarts, last %u ns, max %u ns",
+                    ch, stats.frames, stats.resets, stats.last_ns,
+                    stats.max_ns);
+    }
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_TOLERANCE)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void shellToleranceShow(const struct shell *sh)
+{
+    tolerance_limits_t limits;
+    tolerance_spc_t spc;
+    char nominal[16], lower[16], upper[16], mean[16], stddev[16];
+
+    for (int i=0; i < CONFIG_CALIPER_TOLERANCE_FEATURES; i++) {
+        tolerance_get(i, &limits);
+        if (!limits.defined) {
+            shell_print(sh, "%c%d: -", (i == tolerance_active()) ? '*' : ' ',
+                        i);
+            continue;
+        }
+        format_value(nominal, sizeof(nominal), limits.nominal,
+                     limits.standard, FORMAT_DECIMALS_ALL);
+        format_value(lower, sizeof(lower), limits.lower,
+                     limits.standard, FORMAT_DECIMALS_ALL);
+        format_value(upper, sizeof(upper), limits.upper,
+                     limits.standard, FORMAT_DECIMALS_ALL);
+        shell_print(sh, "%c%d: %s %s / +%s %s",
+                    (i == tolerance_active()) ? '*' : ' ', i,
+                    nominal, lower, upper,
+                    (limits.standard == CALIPER_STANDARD_MM) ? "mm" : "inch");
+    }
+
+    if (tolerance_get_spc(&spc) != 0) {
+        return;
+    }
+    tolerance_get(tolerance_active(), &limits);
+
+    format_value(mean, sizeof(mean), limits.nominal + spc.mean,
+                 limits.standard, FORMAT_DECIMALS_ALL);
+    format_value(stddev, sizeof(stddev), spc.stddev,
+                 limits.standard, FORMAT_DECIMALS_ALL);
+
+    shell_print(sh, "%u parts, %u under, %u over; mean %s sd %s",
+                spc.count, spc.low, spc.high, mean, stddev);
+    shell_print(sh, "Cp %d.%03d  Cpk %s%d.%03d", spc.cp / 1000, spc.cp % 1000,
+                (spc.cpk < 0) ? "-" : "", abs(spc.cpk) / 1000,
+                abs(spc.cpk) % 1000);
+    shell_fprintf(sh, SHELL_NORMAL, "bins:");
+    for (int i=0; i < TOLERANCE_BINS; i++) {
+        shell_fprintf(sh, SHELL_NORMAL, " %u", spc.bins[i]);
+    }
+    shell_fprintf(sh, SHELL_NORMAL, "\n");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  caliper tol set <feature> <nominal> <lower> <upper> [mm|inch]            */
+/*---------------------------------------------------------------------------*/
+static int shellToleranceSet(const struct shell *sh, size_t argc, char *argv[])
+{
+    tolerance_limits_t limits = { .defined = true };
+    caliper_latest_t latest;
+    int ret;
+
+    if (argc < 6) {
+        shell_error(sh, "usage: caliper tol set <feature> <nominal> "
+                    "<lower> <upper> [mm|inch]");
+        return -EINVAL;
+    }
+
+    if (argc > 6) {
+        limits.standard = (strcmp(argv[6], "inch") == 0) ?
+                          CALIPER_STANDARD_INCH : CALIPER_STANDARD_MM;
+    }
+    else if (caliper_latest(0, &latest, NULL) == 0) {
+        limits.standard = latest.standard;
+    }
+    else {
+        limits.standard = CALIPER_STANDARD_MM;
+    }
+
+    if (format_parse(argv[3], limits.standard, &limits.nominal) != 0 ||
+        format_parse(argv[4], limits.standard, &limits.lower) != 0 ||
+        format_parse(argv[5], limits.standard, &limits.upper) != 0) {
+        shell_error(sh, "bad number");
+        return -EINVAL;
+    }
+
+    ret = tolerance_set(atoi(argv[2]), &limits);
+    if (ret != 0) {
+        shell_error(sh, "not set (%d)", ret);
+    }
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  "type" sends the SPC summary as keystrokes, one row.                     */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_tol(const struct shell *sh, size_t argc, char *argv[])
+{
+    static keyboard_key_t keys[CONFIG_CALIPER_OUTPUT_MAX_KEYS];
+    tolerance_limits_t cleared = { .defined = false };
+    int ret = 0;
+
+    if (argc > 1 && strcmp(argv[1], "set") == 0) {
+        ret = shellToleranceSet(sh, argc, argv);
+    }
+    else if (argc > 2 && strcmp(argv[1], "select") == 0) {
+        ret = tolerance_select(atoi(argv[2]));
+    }
+    else if (argc > 2 && strcmp(argv[1], "clear") == 0) {
+        ret = tolerance_set(atoi(argv[2]), &cleared);
+    }
+    else if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        tolerance_reset();
+    }
+    else if (argc > 1 && strcmp(argv[1], "type") == 0) {
+        if (is_bt_connected() == false) {
+            shell_error(sh, "Bluetooth not connected");
+            return -ENOTCONN;
+        }
+        ret = tolerance_render(keys, ARRAY_SIZE(keys));
+        if (ret < 0) {
+            shell_error(sh, "nothing to type (%d)", ret);
+            return ret;
+        }
+        keyboard_send_keys(keys, ret, false);
+        ret = 0;
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper tol "
+                    "[set|select <n>|clear <n>|reset|type]");
+        return -EINVAL;
+    }
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    shellToleranceShow(sh);
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_DATUM)
+/*---------------------------------------------------------------------------*/
+/*  Slot by number or name.                                                  */
+/*---------------------------------------------------------------------------*/
+static int shellDatumSlot(const char * arg)
+{
+    if (isdigit((unsigned char) arg[0])) {
+        return atoi(arg);
+    }
+    return datum_find(arg);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  "zero" reads every channel afresh and takes the readings as the slot's   */
+/*  zero; "use abs" goes back to absolute readings.                          */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_datum(const struct shell *sh, size_t argc, char *argv[])
+{
+    datum_slot_t datum;
+    int32_t value;
+    int standard;
+    char zero[16];
+    int ret = 0;
+
+    if (argc > 2 && strcmp(argv[1], "zero") == 0) {
+        for (int ch=0; ch < caliper_channel_count() && ret == 0; ch++) {
+            ret = caliper_read_channel(ch, &value, &standard);
+        }
+        if (ret == 0) {
+            ret = datum_capture(atoi(argv[2]), (argc > 3) ? argv[3] : NULL);
+        }
+    }
+    else if (argc > 2 && strcmp(argv[1], "use") == 0) {
+        ret = (strcmp(argv[2], "abs") == 0) ?
+              datum_select(DATUM_NONE) : datum_select(shellDatumSlot(argv[2]));
+    }
+    else if (argc > 2 && strcmp(argv[1], "clear") == 0) {
+        ret = datum_clear(shellDatumSlot(argv[2]));
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper datum "
+                    "[zero <n> [name]|use <n|name|abs>|clear <n|name>]");
+        return -EINVAL;
+    }
+
+    if (ret != 0) {
+        shell_error(sh, "failed (%d)", ret);
+        return ret;
+    }
+
+    shell_print(sh, "datum: %s", (datum_active() == DATUM_NONE) ?
+                "absolute" : "relative");
+
+    for (int i=0; i < CONFIG_CALIPER_DATUM_SLOTS; i++) {
+        datum_get(i, &datum);
+        if (!datum.defined) {
+            continue;
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "%c%d %-8s",
+                      (i == datum_active()) ? '*' : ' ', i, datum.name);
+        for (int ch=0; ch < caliper_channel_count(); ch++) {
+            format_value(zero, sizeof(zero), datum.zero[ch],
+                         datum.standard[ch], FORMAT_DECIMALS_ALL);
+            shell_fprintf(sh, SHELL_NORMAL, "  %s %s", zero,
+                          (datum.standard[ch] == CALIPER_STANDARD_MM) ?
+                          "mm" : "inch");
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "\n");
+    }
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_BURST)
+/*---------------------------------------------------------------------------*/
+/*  "start"/"stop" work as holding/releasing SNAPSHOT; "dump" lists the last */
+/*  burst here, for a console (or NUS) rather than the keyboard.            */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_burst(const struct shell *sh, size_t argc, char *argv[])
+{
+    burst_stats_t stats;
+    burst_entry_t entry;
+    char value[16];
+    int ret = 0;
+
+    if (argc > 1 && strcmp(argv[1], "start") == 0) {
+        ret = burst_start();
+    }
+    else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        ret = burst_stop();
+    }
+    else if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        for (int n=0; burst_entry(n, &entry) == 0; n++) {
+            format_value(value, sizeof(value), entry.value, entry.standard,
+                         FORMAT_DECIMALS_DEFAULT);
+            shell_print(sh, "%u\t%u\t%s", entry.ms, entry.channel, value);
+        }
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper burst [start|stop|dump]");
+        return -EINVAL;
+    }
+
+    if (ret != 0) {
+        shell_error(sh, "failed (%d)", ret);
+        return ret;
+    }
+
+    burst_get_stats(&stats);
+
+    shell_print(sh, "burst: %s, %u done, %u frames, %u overflows, "
+                "%u to type", stats.capturing ? "capturing" : "idle",
+                stats.bursts, stats.frames, stats.overflows, stats.pending);
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_SESSION)
+/*---------------------------------------------------------------------------*/
+/*  "type" sends the table as keystrokes and reports the rate achieved;      */
+/*  "list" prints it here.                                                   */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_session(const struct shell *sh, size_t argc, char *argv[])
+{
+    session_report_t report;
+    session_cell_t cell;
+    char value[16];
+    int ret = 0;
+
+    if (argc > 1 && strcmp(argv[1], "on") == 0) {
+        session_enable(true);
+    }
+    else if (argc > 1 && strcmp(argv[1], "off") == 0) {
+        session_enable(false);
+    }
+    else if (argc > 1 && strcmp(argv[1], "next") == 0) {
+        session_next_row();
+    }
+    else if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+        session_clear();
+    }
+    else if (argc > 2 && strcmp(argv[1], "columns") == 0) {
+        ret = session_set_columns(atoi(argv[2]));
+    }
+    else if (argc > 1 && strcmp(argv[1], "list") == 0) {
+        for (int n=0; session_get(n, &cell) == 0; n++) {
+            format_value(value, sizeof(value), cell.value, cell.standard,
+                         FORMAT_DECIMALS_DEFAULT);
+            shell_print(sh, "%3u %2u  %s", cell.row, cell.column, value);
+        }
+    }
+    else if (argc > 1 && strcmp(argv[1], "type") == 0) {
+        ret = session_type(&report);
+        if (ret == 0) {
+            shell_print(sh, "typed %u chars in %u ms, %u chars/s",
+                        report.keys, report.ms,
+                        (report.ms > 0) ?
+                        (uint32_t)((report.keys * 1000ULL) / report.ms) : 0);
+        }
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper session "
+                    "[on|off|next|clear|columns <n>|list|type]");
+        return -EINVAL;
+    }
+
+    if (ret != 0) {
+        shell_error(sh, "failed (%d)", ret);
+        return ret;
+    }
+
+    shell_print(sh, "session: %s, %d of %d cells, %d columns",
+                session_enabled() ? "on" : "off", session_count(),
+                CONFIG_CALIPER_SESSION_SIZE, session_columns());
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_PEAK)
+/*---------------------------------------------------------------------------*/
+/*  "max", "min" or "tir" picks what a hold captures; "disarm" ends it as    */
+/*  SNAPSHOT would.                                                          */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_peak(const struct shell *sh, size_t argc, char *argv[])
+{
+    peak_hold_t hold;
+    char min[16], max[16], tir[16];
+    int ret = 0;
+
+    if (argc > 1 && strcmp(argv[1], "arm") == 0) {
+        ret = peak_arm();
+    }
+    else if (argc > 1 && strcmp(argv[1], "disarm") == 0) {
+        ret = peak_disarm();
+    }
+    else if (argc > 1 && strcmp(argv[1], "max") == 0) {
+        peak_set_mode(PEAK_MAX);
+    }
+    else if (argc > 1 && strcmp(argv[1], "min") == 0) {
+        peak_set_mode(PEAK_MIN);
+    }
+    else if (argc > 1 && strcmp(argv[1], "tir") == 0) {
+        peak_set_mode(PEAK_TIR);
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper peak [arm|disarm|max|min|tir]");
+        return -EINVAL;
+    }
+
+    if (ret != 0) {
+        shell_error(sh, "failed (%d)", ret);
+        return ret;
+    }
+
+    shell_print(sh, "peak: %s, captures %s", peak_armed() ? "armed" : "idle",
+                peak_mode_name(peak_get_mode()));
+
+    for (int ch=0; ch < caliper_channel_count(); ch++) {
+        if (peak_get(ch, &hold) != 0) {
+            continue;
+        }
+        format_value(min, sizeof(min), hold.min, hold.standard,
+                     FORMAT_DECIMALS_ALL);
+        format_value(max, sizeof(max), hold.max, hold.standard,
+                     FORMAT_DECIMALS_ALL);
+        format_value(tir, sizeof(tir), hold.max - hold.min, hold.standard,
+                     FORMAT_DECIMALS_ALL);
+        shell_print(sh, "%d min %s  max %s  tir %s %s  %u frames, "
+                    "%u dropped", ch, min, max, tir,
+                    (hold.standard == CALIPER_STANDARD_MM) ? "mm" : "inch",
+                    hold.frames, hold.dropped);
+    }
+
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_CALIPER_STATS)
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void shellStatsPrint(const struct shell *sh, int channel,
+                            stats_scope_t scope)
+{
+    stats_summary_t summary;
+    char mean[16], stddev[16], min[16], max[16], range[16];
+
+    if (stats_get(channel, scope, &summary) != 0) {
+        return;
+    }
+
+    format_value(mean,   sizeof(mean),   summary.mean,   summary.standard,
+                 FORMAT_DECIMALS_ALL);
+    format_value(stddev, sizeof(stddev), summary.stddev, summary.standard,
+                 FORMAT_DECIMALS_ALL);
+    format_value(min,    sizeof(min),    summary.min,    summary.standard,
+                 FORMAT_DECIMALS_ALL);
+    format_value(max,    sizeof(max),    summary.max,    summary.standard,
+                 FORMAT_DECIMALS_ALL);
+    format_value(range,  sizeof(range),  summary.max - summary.min,
+                 summary.standard, FORMAT_DECIMALS_ALL);
+
+    shell_print(sh, "%d %-7s %5u  mean %s  sd %s  min %s  max %s  "
+                "range %s %s", channel,
+                (scope == STATS_SESSION) ? "session" : "window",
+                summary.count, mean, stddev, min, max, range,
+                (summary.standard == CALIPER_STANDARD_MM) ? "mm" : "inch");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  "type" sends the session summary as keystrokes, one row per channel.     */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_stats(const struct shell *sh, size_t argc, char *argv[])
+{
+    static keyboard_key_t keys[CONFIG_CALIPER_OUTPUT_MAX_KEYS];
+    int ret;
+
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        stats_reset();
+    }
+    else if (argc > 1 && strcmp(argv[1], "type") == 0) {
+        if (is_bt_connected() == false) {
+            shell_error(sh, "Bluetooth not connected");
+            return -ENOTCONN;
+        }
+        ret = stats_render(STATS_SESSION, keys, ARRAY_SIZE(keys));
+        if (ret < 0) {
+            shell_error(sh, "nothing to type (%d)", ret);
+            return ret;
+        }
+        keyboard_send_keys(keys, ret, false);
+    }
+    else if (argc > 2 && strcmp(argv[1], "summary") == 0 &&
+             (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        stats_set_summary_only(strcmp(argv[2], "on") == 0);
+    }
+    else if (argc > 1) {
+        shell_error(sh, "usage: caliper stats [reset|type|summary on|off]");
+        return -EINVAL;
+    }
+
+    shell_print(sh, "summary only: %s, window %d",
+                stats_summary_only() ? "on" : "off",
+                CONFIG_CALIPER_STATS_WINDOW);
+
+    for (int ch=0; ch < caliper_channel_count(); ch++) {
+        shellStatsPrint(sh, ch, STATS_WINDOW);
+        shellStatsPrint(sh, ch, STATS_SESSION);
+    }
+
+    return 0;
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -151,6 +957,56 @@ static int cmd_shell_standard(const struct shell *sh, size_t argc, char *argv[])
     return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_units(const struct shell *sh, size_t argc, char *argv[])
+{
+    if (argc > 1) {
+        if (strcmp(argv[1], "caliper") == 0) {
+            units_set_policy(AS_CALIPER);
+        }
+        else if (strcmp(argv[1], "mm") == 0) {
+            units_set_policy(ALWAYS_MM);
+        }
+        else if (strcmp(argv[1], "inch") == 0) {
+            units_set_policy(ALWAYS_INCH);
+        }
+        else {
+            shell_error(sh, "expected caliper, mm or inch");
+            return -EINVAL;
+        }
+    }
+
+    shell_print(sh, "[units] %s", unitsName(units_get_policy()));
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Template syntax: see output.c                                            */
+/*---------------------------------------------------------------------------*/
+static int cmd_shell_template(const struct shell *sh, size_t argc, char *argv[])
+{
+    int ret;
+
+    if (argc > 1) {
+        ret = output_compile(argv[1]);
+        if (ret == -ENOSPC) {
+            shell_error(sh, "template too long");
+            return ret;
+        }
+        if (ret != 0) {
+            shell_error(sh, "bad template");
+            return ret;
+        }
+    }
+
+    shell_print(sh, "[template] %s", output_template());
+
+    return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -176,8 +1032,43 @@ SHELL_STATIC_SUBCMD_SET_CREATE(caliper_cmds,
     SHELL_CMD_ARG(test, NULL, "caliper test <string>", cmd_shell_test, 2, 0),
     SHELL_CMD(line_end, NULL, "caliper line_end (toggle)", cmd_shell_line_end),
     SHELL_CMD(standard, NULL, "caliper standard (toggle)", cmd_shell_standard),
+    SHELL_CMD_ARG(units, NULL, "caliper units [caliper|mm|inch]", cmd_shell_units, 1, 1),
+    SHELL_CMD_ARG(template, NULL, "caliper template [\"<template>\"] (output format)", cmd_shell_template, 1, 1),
     SHELL_CMD(info,     NULL, "caliper info", cmd_shell_info),
     SHELL_CMD(snap,     NULL, "caliper snap (snapshot)", cmd_shell_snap),
+    SHELL_CMD(history,  NULL, "caliper history (recent frames)", cmd_shell_history),
+    SHELL_CMD_ARG(protocol, NULL, "caliper protocol [name|auto] [channel]", cmd_shell_protocol, 1, 2),
+    SHELL_CMD(bench,    NULL, "caliper bench (decoder timing)", cmd_shell_bench),
+#if defined(CONFIG_CALIPER_PHASE_LOCK)
+    SHELL_CMD(phase,    NULL, "caliper phase (frame lock)", cmd_shell_phase),
+#endif
+#if defined(CONFIG_CALIPER_SIGNAL_MONITOR)
+    SHELL_CMD_ARG(signal, NULL, "caliper signal [reset] (signal quality)", cmd_shell_signal, 1, 1),
+#endif
+#if defined(CONFIG_CALIPER_AUTO_CAPTURE)
+    SHELL_CMD_ARG(auto, NULL, "caliper auto [on|off] (capture on settle)", cmd_shell_auto, 1, 1),
+#endif
+#if defined(CONFIG_CALIPER_FILTER)
+    SHELL_CMD_ARG(filter, NULL, "caliper filter [off|median|iir|kalman|average on|off]", cmd_shell_filter, 1, 2),
+#endif
+#if defined(CONFIG_CALIPER_TOLERANCE)
+    SHELL_CMD_ARG(tol, NULL, "caliper tol [set <n> <nominal> <lower> <upper> [mm|inch]|select <n>|clear <n>|reset|type]", cmd_shell_tol, 1, 6),
+#endif
+#if defined(CONFIG_CALIPER_DATUM)
+    SHELL_CMD_ARG(datum, NULL, "caliper datum [zero <n> [name]|use <n|name|abs>|clear <n|name>]", cmd_shell_datum, 1, 3),
+#endif
+#if defined(CONFIG_CALIPER_BURST)
+    SHELL_CMD_ARG(burst, NULL, "caliper burst [start|stop|dump]", cmd_shell_burst, 1, 1),
+#endif
+#if defined(CONFIG_CALIPER_SESSION)
+    SHELL_CMD_ARG(session, NULL, "caliper session [on|off|next|clear|columns <n>|list|type]", cmd_shell_session, 1, 2),
+#endif
+#if defined(CONFIG_CALIPER_PEAK)
+    SHELL_CMD_ARG(peak, NULL, "caliper peak [arm|disarm|max|min|tir]", cmd_shell_peak, 1, 1),
+#endif
+#if defined(CONFIG_CALIPER_STATS)
+    SHELL_CMD_ARG(stats, NULL, "caliper stats [reset|type|summary on|off]", cmd_shell_stats, 1, 2),
+#endif
     SHELL_CMD(reboot,   NULL, "caliper reboot", cmd_shell_reboot),
     SHELL_SUBCMD_SET_END
 );
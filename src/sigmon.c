@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  sigmon.c  -- Caliper signal-quality monitor
+ *
+ *  The capture engines report CLOCK pulse widths and interframe gaps as
+ *  they go by, and the backend every raw frame with its decode result.
+ *  Kept per channel: log2 histograms of the widths, glitch and short
+ *  pulse counters; kept for all channels: a ring of the last raw frames.
+ *  Enough to tell cable noise or a marginal caliper from a decoder bug,
+ *  without a logic analyzer.  See "caliper signal".
+ */
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "sigmon.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sigmon, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define SIGMON_FRAMES   CONFIG_CALIPER_SIGNAL_FRAMES
+
+static struct k_spinlock sigmon_lock;
+
+static sigmon_stats_t stats [CALIPER_CHANNELS];
+
+static sigmon_frame_t ring [SIGMON_FRAMES];
+static uint32_t       head;         // total frames put
+
+/*---------------------------------------------------------------------------*/
+/*  Called from the capture engines, possibly at interrupt level: keep it    */
+/*  to a few instructions.                                                   */
+/*---------------------------------------------------------------------------*/
+void sigmon_width(int channel, sigmon_histogram_t histogram, uint32_t us)
+{
+    sigmon_stats_t * st = &stats[channel];
+    uint32_t bit_us = decoder_bit_period_us(channel);
+    uint32_t expect;
+    int bin;
+
+    bin = (us == 0) ? 0 : (31 - __builtin_clz(us));
+    if (bin >= SIGMON_BINS) {
+        bin = SIGMON_BINS - 1;
+    }
+    st->bins[histogram][bin]++;
+
+    if (histogram == SIGMON_GAP) {
+        return;
+    }
+
+    if (us < CONFIG_CALIPER_SIGNAL_GLITCH_US) {
+        st->glitches++;
+        return;
+    }
+
+    /*
+     *  Short: under half of what a clean caliper would produce,
+     *  a whole bit period for PERIOD, about half of one for LOW/HIGH.
+     */
+    expect = (histogram == SIGMON_PERIOD) ? bit_us : bit_us / 2;
+    if (us < expect / 2) {
+        st->short_pulses++;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sigmon_frame(int channel, const caliper_frame_t * frame, int status)
+{
+    sigmon_frame_t * entry;
+    k_spinlock_key_t key = k_spin_lock(&sigmon_lock);
+
+    stats[channel].frames++;
+    if (status != 0) {
+        stats[channel].bad_frames++;
+    }
+
+    entry = &ring[head % SIGMON_FRAMES];
+    entry->timestamp = k_uptime_ticks();
+    entry->frame     = *frame;
+    entry->status    = (int8_t) status;
+    entry->channel   = (uint8_t) channel;
+    head++;
+
+    k_spin_unlock(&sigmon_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sigmon_get_stats(int channel, sigmon_stats_t * st)
+{
+    k_spinlock_key_t key = k_spin_lock(&sigmon_lock);
+
+    *st = stats[channel];
+
+    k_spin_unlock(&sigmon_lock, key);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Copy up to count most recent frames, newest first.                       */
+/*---------------------------------------------------------------------------*/
+int sigmon_frames(sigmon_frame_t * frames, int count)
+{
+    int i;
+    k_spinlock_key_t key = k_spin_lock(&sigmon_lock);
+
+    count = MIN(count, MIN(head, SIGMON_FRAMES));
+
+    for (i=0; i < count; i++) {
+        frames[i] = ring[(head - 1 - i) % SIGMON_FRAMES];
+    }
+
+    k_spin_unlock(&sigmon_lock, key);
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sigmon_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&sigmon_lock);
+
+    memset(stats, 0, sizeof(stats));
+    head = 0;
+
+    k_spin_unlock(&sigmon_lock, key);
+
+    LOG_INF("%s", __func__);
+}
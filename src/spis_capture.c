@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  spis_capture.c  -- Caliper frame capture via SPIS with EasyDMA
+ *
+ *  The caliper drives CLOCK and DATA like an SPI master that never
+ *  asserts a chip-select.  SPIS samples DATA on the falling CLOCK edge
+ *  (CPOL=1, CPHA=0), LSB first, and EasyDMA drops the frame bits
+ *  into rx_buffer without any CPU involvement.  Only whole bytes are
+ *  stored, so protocols must be a multiple of 8 bits long.
+ *
+ *  CSN is routed to the SELECT pin, which is not wired to the caliper:
+ *  firmware drives it low to open a transaction in the interframe gap
+ *  and high once the frame is over, which produces the SPIS END event.
+ *
+ *  The frame is timed without touching its bits: GPIOTE raises an event
+ *  on every falling CLOCK edge and PPI routes it to a TIMER3 CAPTURE
+ *  task, so CC[0] always holds the latest edge.  Only the first edge of
+ *  an armed frame interrupts, to note the start and wake the caliper
+ *  thread; the duration (and so the bit period) is read after the frame.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/spi.h>
+
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+
+#include "spis_capture.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(spis_capture, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define SPIS_FRAME_BYTES   8      /* up to 64 bits */
+
+#define SELECTED     0
+#define DESELECTED   1
+
+#define SPIS_CC_EDGE  NRF_TIMER_CC_CHANNEL0     /* by PPI, every edge */
+#define SPIS_CC_NOW   NRF_TIMER_CC_CHANNEL1     /* by firmware */
+
+BUILD_ASSERT(DT_NODE_HAS_STATUS(SPIS_NODE, okay),
+             "SPIS capture needs the spis-capture snippet (-S spis-capture)");
+
+static const struct device * const spis_dev = DEVICE_DT_GET(SPIS_NODE);
+
+static const struct gpio_dt_spec select_spec = 
+                        GPIO_DT_SPEC_GET_OR(SELECT_NODE, gpios, 0);
+
+static const struct gpio_dt_spec data_spec = 
+                        GPIO_DT_SPEC_GET_OR(DATA_NODE, gpios, 0);
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(0);
+static const nrfx_timer_t  timer  = NRFX_TIMER_INSTANCE(3);
+
+static const uint32_t clock_psel = NRF_DT_GPIOS_TO_PSEL(CLOCK_NODE, gpios);
+
+static spis_capture_start_t start_handler = NULL;
+
+static uint32_t first_edge;     // TIMER3, first edge of the armed frame
+
+static const struct spi_config spis_cfg = {
+    .operation = SPI_OP_MODE_SLAVE | SPI_WORD_SET(8) |
+                 SPI_MODE_CPOL | SPI_TRANSFER_LSB,
+    .frequency = 0,     /* clocked by the caliper */
+    .slave     = 0,
+};
+
+static uint8_t rx_buffer [SPIS_FRAME_BYTES];
+
+static const struct spi_buf rx_buf = {
+    .buf = rx_buffer,
+    .len = sizeof(rx_buffer),
+};
+
+static const struct spi_buf_set rx_set = {
+    .buffers = &rx_buf,
+    .count   = 1,
+};
+
+static struct k_poll_signal spis_sig = K_POLL_SIGNAL_INITIALIZER(spis_sig);
+
+static struct k_poll_event  spis_evt =
+                               K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+                               K_POLL_MODE_NOTIFY_ONLY,
+                               &spis_sig);
+
+/*---------------------------------------------------------------------------*/
+/*  Timestamp base only: no compares, nothing to handle.                     */
+/*---------------------------------------------------------------------------*/
+static void spisTimerHandler(nrf_timer_event_t event, void * context)
+{
+    ARG_UNUSED(event);
+    ARG_UNUSED(context);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Keep the CLOCK event (for PPI) with or without its interrupt.            */
+/*---------------------------------------------------------------------------*/
+static void spisClockInterrupt(bool enable)
+{
+    nrfx_gpiote_trigger_disable(&gpiote, clock_psel);
+    nrfx_gpiote_trigger_enable(&gpiote, clock_psel, enable);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  First falling CLOCK edge of an armed frame, already captured by PPI.     */
+/*---------------------------------------------------------------------------*/
+static void spisClockHandler(nrfx_gpiote_pin_t pin,
+                             nrfx_gpiote_trigger_t trigger,
+                             void * context)
+{
+    first_edge = nrfx_timer_capture_get(&timer, SPIS_CC_EDGE);
+
+    spisClockInterrupt(false);
+
+    if (start_handler) {
+        start_handler();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Open an SPIS transaction; must be called from within interframe gap.     */
+/*---------------------------------------------------------------------------*/
+int spis_capture_arm(void)
+{
+    int ret;
+
+    memset(rx_buffer, 0, sizeof(rx_buffer));
+
+    k_poll_signal_reset(&spis_sig);
+    spis_evt.state = K_POLL_STATE_NOT_READY;
+
+    ret = spi_read_signal(spis_dev, &spis_cfg, &rx_set, &spis_sig);
+    if (ret != 0) {
+        LOG_ERR("%s: spi_read_signal failed: %d", __func__, ret);
+        return ret;
+    }
+
+    gpio_pin_set_raw(select_spec.port, select_spec.pin, SELECTED);
+
+    spisClockInterrupt(true);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Stop watching for a frame.  An open transaction is left to the next      */
+/*  spis_capture_arm() or spis_capture_frame().                              */
+/*---------------------------------------------------------------------------*/
+void spis_capture_disarm(void)
+{
+    spisClockInterrupt(false);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called after the first CLOCK edge of the frame; units_us is when the     */
+/*  units flag is valid on DATA, from that edge.  *duration is first to     */
+/*  last edge.                                                               */
+/*  NOTE: this function runs on caliper thread, not interrupt level          */
+/*---------------------------------------------------------------------------*/
+int spis_capture_frame(uint32_t units_us, uint64_t * frame, int * bits,
+                       int * units, uint32_t * duration)
+{
+    unsigned int signaled;
+    uint32_t elapsed;
+    int result;
+
+    /*
+     *  EasyDMA is filling rx_buffer; sleep (not spin) until the frame
+     *  has gone by and the out-of-frame units flag is up.
+     */
+    elapsed = nrfx_timer_capture(&timer, SPIS_CC_NOW) - first_edge;
+    if (units_us > elapsed) {
+        k_sleep(K_USEC(units_us - elapsed));
+    }
+
+    *units    = gpio_pin_get_dt(&data_spec);
+    *duration = nrfx_timer_capture_get(&timer, SPIS_CC_EDGE) - first_edge;
+
+    /*
+     *  Releasing CSN ends the transaction: SPIS raises END and the
+     *  driver signals completion with the received byte count.
+     */
+    gpio_pin_set_raw(select_spec.port, select_spec.pin, DESELECTED);
+
+    k_poll(&spis_evt, 1, K_MSEC(10));
+
+    k_poll_signal_check(&spis_sig, &signaled, &result);
+    if (!signaled) {
+        LOG_WRN("%s: no SPIS completion", __func__);
+        return -ETIMEDOUT;
+    }
+
+    if (result <= 0 || result > SPIS_FRAME_BYTES) {
+        LOG_WRN("%s: bad frame: %d bytes", __func__, result);
+        return -EIO;
+    }
+
+    /* LSB-first transfer: bytes arrive in frame bit order. */
+    *frame = 0;
+    for (int i=0; i < result; i++) {
+        *frame |= (uint64_t) rx_buffer[i] << (i * 8);
+    }
+    *bits = result * 8;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void spis_capture_init(spis_capture_start_t start)
+{
+    nrfx_err_t err;
+    uint8_t    in_channel;
+    uint8_t    ppi_channel;
+
+    static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_PULLDOWN;
+
+    LOG_INF("%s", __func__);
+
+    start_handler = start;
+
+    if (!device_is_ready(spis_dev)) {
+        LOG_ERR("Error: SPIS %s is not ready", spis_dev->name);
+        return;
+    }
+
+    /*
+     *  SELECT drives the SPIS CSN input: keep it deselected until armed.
+     */
+    gpio_pin_configure_dt(&select_spec, (GPIO_INPUT | GPIO_OUTPUT_HIGH));
+
+    /*
+     *  TIMER3: 1 MHz free-running timestamp base.
+     */
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+    err = nrfx_timer_init(&timer, &timer_cfg, spisTimerHandler);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: timer init failed", err);
+        return;
+    }
+    nrfx_timer_enable(&timer);
+
+    /*
+     *  GPIOTE: event on falling CLOCK edge; interrupt only when armed.
+     */
+    err = nrfx_gpiote_channel_alloc(&gpiote, &in_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no GPIOTE channel", err);
+        return;
+    }
+
+    nrfx_gpiote_trigger_config_t trigger_config = {
+        .trigger      = NRFX_GPIOTE_TRIGGER_HITOLO,
+        .p_in_channel = &in_channel,
+    };
+    nrfx_gpiote_handler_config_t handler_config = {
+        .handler      = spisClockHandler,
+        .p_context    = NULL,
+    };
+    nrfx_gpiote_input_pin_config_t input_config = {
+        .p_pull_config    = &pull,
+        .p_trigger_config = &trigger_config,
+        .p_handler_config = &handler_config,
+    };
+
+    err = nrfx_gpiote_input_configure(&gpiote, clock_psel, &input_config);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: failed to configure clock", err);
+        return;
+    }
+
+    /*
+     *  PPI: CLOCK edge event -> TIMER3 CAPTURE[0] task.
+     */
+    err = nrfx_gppi_channel_alloc(&ppi_channel);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("Error 0x%x: no PPI channel", err);
+        return;
+    }
+
+    nrfx_gppi_channel_endpoints_setup(ppi_channel,
+        nrfx_gpiote_in_event_address_get(&gpiote, clock_psel),
+        nrfx_timer_capture_task_address_get(&timer, SPIS_CC_EDGE));
+
+    nrfx_gppi_channels_enable(BIT(ppi_channel));
+
+    spisClockInterrupt(false);
+
+    LOG_INF("SPIS '%s', %s on pin %d", spis_dev->name, SELECT_LABEL, SELECT);
+}
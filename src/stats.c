@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  stats.c  -- Running statistics over captured readings
+ *
+ *  Every reading that is captured (snapshot or auto-capture) is added to
+ *  two accumulators per channel: a session, kept since the last reset,
+ *  and a sliding window of the last CONFIG_CALIPER_STATS_WINDOW readings.
+ *  Both hold count, min, max, mean and the sum of squared deviations
+ *  (M2) by Welford's method, updated in O(1) per reading.
+ *
+ *  Means are fixed point with STATS_FRAC fraction bits, in reading
+ *  counts; M2 is in counts squared with the same scaling.  A window
+ *  reading that falls out is removed with the inverse Welford step, and
+ *  the window is recomputed from its ring once per lap so that rounding
+ *  cannot drift.  Window min/max come from monotonic queues of sample
+ *  numbers, amortised O(1).  Readings in the other standard are
+ *  converted to the channel's first one.
+ */
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "stats.h"
+#include "caliper.h"
+#include "fixed.h"
+#include "caliper_gpio.h"
+#include "format.h"
+#include "units.h"
+#include "output.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(stats, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define STATS_FRAC      8
+#define STATS_WINDOW_N  CONFIG_CALIPER_STATS_WINDOW
+
+typedef struct {
+    uint32_t  count;
+    int32_t   min;
+    int32_t   max;
+    int64_t   mean;       // Q STATS_FRAC counts
+    int64_t   m2;         // Q STATS_FRAC counts^2
+} stats_acc_t;
+
+/* Monotonic queue of sample numbers, front is the window min (or max). */
+typedef struct {
+    uint32_t  seq [STATS_WINDOW_N];
+    uint16_t  front;
+    uint16_t  length;
+} stats_queue_t;
+
+typedef struct {
+    bool          have;
+    uint8_t       standard;
+    stats_acc_t   session;
+    stats_acc_t   window;
+    int32_t       ring [STATS_WINDOW_N];
+    uint32_t      samples;       // readings added to the window ring
+    stats_queue_t lows;
+    stats_queue_t highs;
+} stats_channel_t;
+
+static stats_channel_t channels [CALIPER_CHANNELS];
+
+static bool summary_only = IS_ENABLED(CONFIG_CALIPER_STATS_SUMMARY_ONLY);
+
+K_MUTEX_DEFINE(stats_mutex);
+
+/*---------------------------------------------------------------------------*/
+/*  Welford step: add x.                                                     */
+/*---------------------------------------------------------------------------*/
+static void statsAdd(stats_acc_t * acc, int32_t x)
+{
+    int64_t xq = (int64_t) x << STATS_FRAC;
+    int64_t delta;
+
+    acc->count++;
+
+    if (acc->count == 1) {
+        acc->min  = x;
+        acc->max  = x;
+        acc->mean = xq;
+        acc->m2   = 0;
+        return;
+    }
+
+    acc->min = MIN(acc->min, x);
+    acc->max = MAX(acc->max, x);
+
+    delta      = xq - acc->mean;
+    acc->mean += fixed_div_round(delta, acc->count);
+    acc->m2   += (delta * (xq - acc->mean)) >> STATS_FRAC;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Welford step for a full window: x_in replaces x_out, count unchanged.    */
+/*---------------------------------------------------------------------------*/
+static void statsReplace(stats_acc_t * acc, int32_t x_in, int32_t x_out)
+{
+    int64_t in_q  = (int64_t) x_in  << STATS_FRAC;
+    int64_t out_q = (int64_t) x_out << STATS_FRAC;
+    int64_t old_mean = acc->mean;
+
+    acc->mean += fixed_div_round(in_q - out_q, acc->count);
+    acc->m2   += ((in_q - out_q) *
+                  ((in_q - acc->mean) + (out_q - old_mean))) >> STATS_FRAC;
+
+    if (acc->m2 < 0) {
+        acc->m2 = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Exact mean and M2 of a full window, from its ring.  Once per lap.       */
+/*---------------------------------------------------------------------------*/
+static void statsRecompute(stats_channel_t * ch)
+{
+    int64_t sum = 0;
+    int64_t m2  = 0;
+    int64_t mean;
+    int64_t d;
+
+    for (int i=0; i < STATS_WINDOW_N; i++) {
+        sum += ch->ring[i];
+    }
+    mean = fixed_div_round(sum << STATS_FRAC, STATS_WINDOW_N);
+
+    for (int i=0; i < STATS_WINDOW_N; i++) {
+        d   = ((int64_t) ch->ring[i] << STATS_FRAC) - mean;
+        m2 += (d * d) >> STATS_FRAC;
+    }
+
+    ch->window.mean = mean;
+    ch->window.m2   = m2;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Push sample seq into a monotonic queue, after expiring old samples.      */
+/*  Keeps the values in increasing order for lows, decreasing for highs.    */
+/*---------------------------------------------------------------------------*/
+static void statsQueuePush(stats_channel_t * ch, stats_queue_t * q,
+                           uint32_t seq, bool lows)
+{
+    uint16_t back;
+    int32_t  x = ch->ring[seq % STATS_WINDOW_N];
+    int32_t  y;
+
+    while (q->length > 0 && seq - q->seq[q->front] >= STATS_WINDOW_N) {
+        q->front = (q->front + 1) % STATS_WINDOW_N;
+        q->length--;
+    }
+
+    while (q->length > 0) {
+        back = (q->front + q->length - 1) % STATS_WINDOW_N;
+        y = ch->ring[q->seq[back] % STATS_WINDOW_N];
+        if (lows ? (y < x) : (y > x)) {
+            break;
+        }
+        q->length--;
+    }
+
+    q->seq[(q->front + q->length) % STATS_WINDOW_N] = seq;
+    q->length++;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void statsWindowAdd(stats_channel_t * ch, int32_t x)
+{
+    uint32_t seq  = ch->samples++;
+    int      slot = seq % STATS_WINDOW_N;
+
+    if (ch->window.count < STATS_WINDOW_N) {
+        ch->ring[slot] = x;
+        statsAdd(&ch->window, x);
+    }
+    else {
+        statsReplace(&ch->window, x, ch->ring[slot]);
+        ch->ring[slot] = x;
+        if (slot == STATS_WINDOW_N - 1) {
+            statsRecompute(ch);
+        }
+    }
+
+    statsQueuePush(ch, &ch->lows,  seq, true);
+    statsQueuePush(ch, &ch->highs, seq, false);
+
+    ch->window.min = ch->ring[ch->lows.seq[ch->lows.front]   % STATS_WINDOW_N];
+    ch->window.max = ch->ring[ch->highs.seq[ch->highs.front] % STATS_WINDOW_N];
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A captured reading.                                                      */
+/*---------------------------------------------------------------------------*/
+void stats_reading(int channel, int32_t value, int standard)
+{
+    stats_channel_t * ch;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return;
+    }
+    ch = &channels[channel];
+
+    k_mutex_lock(&stats_mutex, K_FOREVER);
+
+    if (!ch->have) {
+        ch->have     = true;
+        ch->standard = standard;
+    }
+    value = units_convert(value, standard, ch->standard);
+
+    statsAdd(&ch->session, value);
+    statsWindowAdd(ch, value);
+
+    k_mutex_unlock(&stats_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Returns 0, -EINVAL, or -ENODATA if the channel has no readings yet.      */
+/*---------------------------------------------------------------------------*/
+int stats_get(int channel, stats_scope_t scope, stats_summary_t * summary)
+{
+    stats_channel_t * ch;
+    stats_acc_t * acc;
+    int64_t variance;
+
+    if (channel < 0 || channel >= CALIPER_CHANNELS) {
+        return -EINVAL;
+    }
+    ch  = &channels[channel];
+    acc = (scope == STATS_SESSION) ? &ch->session : &ch->window;
+
+    k_mutex_lock(&stats_mutex, K_FOREVER);
+
+    if (acc->count == 0) {
+        k_mutex_unlock(&stats_mutex);
+        return -ENODATA;
+    }
+
+    summary->count    = acc->count;
+    summary->min      = acc->min;
+    summary->max      = acc->max;
+    summary->standard = ch->standard;
+    summary->mean     = (int32_t) fixed_div_round(acc->mean, 1 << STATS_FRAC);
+
+    /*
+     *  Variance is Q STATS_FRAC, so its square root is Q STATS_FRAC/2.
+     */
+    variance = (acc->count > 1) ? acc->m2 / (acc->count - 1) : 0;
+    summary->stddev = (int32_t) fixed_div_round(fixed_sqrt(variance),
+                                                1 << (STATS_FRAC / 2));
+
+    k_mutex_unlock(&stats_mutex);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start a new session (and an empty window) on every channel.              */
+/*---------------------------------------------------------------------------*/
+void stats_reset(void)
+{
+    k_mutex_lock(&stats_mutex, K_FOREVER);
+    memset(channels, 0, sizeof(channels));
+    k_mutex_unlock(&stats_mutex);
+
+    LOG_INF("%s", __func__);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Summary only: captured readings are accumulated but not typed.           */
+/*---------------------------------------------------------------------------*/
+void stats_set_summary_only(bool enable)
+{
+    summary_only = enable;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool stats_summary_only(void)
+{
+    return summary_only;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Keystrokes for the summary: one row per channel with data,               */
+/*      count TAB mean TAB stddev TAB min TAB max TAB range ENTER            */
+/*  mean and stddev with every decimal, the rest as readings are typed.      */
+/*  Returns the number of keys, or -ENODATA / -ENOSPC.                       */
+/*---------------------------------------------------------------------------*/
+int stats_render(stats_scope_t scope, keyboard_key_t * keys, int size)
+{
+    stats_summary_t summary;
+    char    text [6][16];
+    const char * cells [6];
+    int32_t values [5];
+    int     length = 0;
+    int     rows = 0;
+    int     ret;
+
+    for (int i=0; i < CALIPER_CHANNELS; i++) {
+
+        if (stats_get(i, scope, &summary) != 0) {
+            continue;
+        }
+
+        values[0] = summary.mean;
+        values[1] = summary.stddev;
+        values[2] = summary.min;
+        values[3] = summary.max;
+        values[4] = summary.max - summary.min;
+
+        snprintf(text[0], sizeof(text[0]), "%u", summary.count);
+        for (int c=0; c < ARRAY_SIZE(values); c++) {
+            format_value(text[c + 1], sizeof(text[c + 1]), values[c],
+                         summary.standard,
+                         (c < 2) ? FORMAT_DECIMALS_ALL :
+                                   FORMAT_DECIMALS_DEFAULT);
+        }
+        for (int c=0; c < ARRAY_SIZE(cells); c++) {
+            cells[c] = text[c];
+        }
+
+        ret = output_cells(cells, ARRAY_SIZE(cells), &keys[length],
+                           size - length);
+        if (ret < 0) {
+            return ret;
+        }
+        length += ret;
+        rows++;
+    }
+
+    return (rows > 0) ? length : -ENODATA;
+}
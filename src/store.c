@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  store.c  -- Settings tables
+ *
+ *  Tolerance features, datum slots and session cells are each kept as a
+ *  settings subtree of numbered items plus one int saying which is active
+ *  or how many there are.  Each module still owns its handler and saves
+ *  its own entries; loading them back is done here.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "store.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(store, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*  Settings set handler body: name is relative to the table's subtree.      */
+/*---------------------------------------------------------------------------*/
+int store_table_set(const store_table_t * table, const char * name,
+                    size_t len, settings_read_cb read_cb, void * cb_arg)
+{
+    int n;
+
+    if (strcmp(name, table->scalar) == 0) {
+        if (len != sizeof(*table->value)) {
+            return -EINVAL;
+        }
+        return MIN(read_cb(cb_arg, table->value, sizeof(*table->value)), 0);
+    }
+
+    if (!isdigit((unsigned char) name[0])) {
+        return -ENOENT;
+    }
+    n = atoi(name);
+    if (n >= table->item_count || len != table->item_size) {
+        return -EINVAL;
+    }
+    return MIN(read_cb(cb_arg, (uint8_t *) table->items + n * table->item_size,
+                       table->item_size), 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Load the table's subtree; the caller checks what it got.                 */
+/*---------------------------------------------------------------------------*/
+int store_table_load(const store_table_t * table)
+{
+    int ret;
+
+    ret = settings_subsys_init();
+    if (ret == 0) {
+        ret = settings_load_subtree(table->subtree);
+    }
+    if (ret != 0) {
+        LOG_ERR("%s: %s settings failed: %d", __func__, table->subtree, ret);
+    }
+    return ret;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  tolerance.c  -- Go/no-go against feature limits, with SPC
+ *
+ *  Up to CONFIG_CALIPER_TOLERANCE_FEATURES features, each a nominal with
+ *  lower and upper deviations, are kept in settings ("tol/<n>"), along
+ *  with the active one ("tol/active").  Each captured reading of channel
+ *  0 is classified against the active feature, inclusive of the limits,
+ *  and counted in the session SPC accumulator:
+ *
+ *      sums of the deviation d from nominal and of d^2, exact in 64 bits
+ *      out-of-spec counts, low and high
+ *      a histogram of CONFIG_CALIPER_TOLERANCE_BINS bins across the
+ *      tolerance band, plus one below and one above
+ *
+ *  Mean, standard deviation, Cp = (USL - LSL) / 6 sigma and
+ *  Cpk = min(USL - mean, mean - LSL) / 3 sigma are worked out when asked
+ *  for, in fixed point.  Selecting another feature starts a new session.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "tolerance.h"
+#include "caliper.h"
+#include "fixed.h"
+#include "format.h"
+#include "output.h"
+#include "units.h"
+#include "store.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(tolerance, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define TOLERANCE_FEATURES   CONFIG_CALIPER_TOLERANCE_FEATURES
+
+static tolerance_limits_t features [TOLERANCE_FEATURES];
+
+static int active = 0;
+
+static struct {
+    uint32_t  count;
+    uint32_t  low;
+    uint32_t  high;
+    int64_t   sum;        // of d, counts
+    int64_t   squares;    // of d^2, counts^2
+    uint32_t  bins [TOLERANCE_BINS];
+} spc;
+
+K_MUTEX_DEFINE(tolerance_mutex);
+
+/*---------------------------------------------------------------------------*/
+/*  Settings: "tol/active" and "tol/<feature>".                              */
+/*---------------------------------------------------------------------------*/
+static const store_table_t tolerance_store = {
+    .subtree    = "tol",
+    .scalar     = "active",
+    .value      = &active,
+    .items      = features,
+    .item_size  = sizeof(features[0]),
+    .item_count = TOLERANCE_FEATURES,
+};
+
+static int toleranceSettingsSet(const char * name, size_t len,
+                                settings_read_cb read_cb, void * cb_arg)
+{
+    return store_table_set(&tolerance_store, name, len, read_cb, cb_arg);
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(tolerance, "tol", NULL, toleranceSettingsSet,
+                               NULL, NULL);
+
+/*---------------------------------------------------------------------------*/
+/*  Deviation from the active feature's nominal, in its standard.            */
+/*---------------------------------------------------------------------------*/
+static tolerance_class_t toleranceClassify(int32_t value, int standard,
+                                           int32_t * deviation)
+{
+    const tolerance_limits_t * limits = &features[active];
+
+    if (!limits->defined) {
+        return TOLERANCE_NONE;
+    }
+
+    *deviation = units_convert(value, standard, limits->standard) -
+                 limits->nominal;
+
+    if (*deviation < limits->lower) {
+        return TOLERANCE_LOW;
+    }
+    if (*deviation > limits->upper) {
+        return TOLERANCE_HIGH;
+    }
+    return TOLERANCE_PASS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+tolerance_class_t tolerance_classify(int32_t value, int standard)
+{
+    tolerance_class_t result;
+    int32_t deviation;
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+    result = toleranceClassify(value, standard, &deviation);
+    k_mutex_unlock(&tolerance_mutex);
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A captured reading: classify it and count it in the SPC session.         */
+/*---------------------------------------------------------------------------*/
+tolerance_class_t tolerance_capture(int32_t value, int standard)
+{
+    const tolerance_limits_t * limits;
+    tolerance_class_t result;
+    int32_t deviation;
+    int     bin;
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+
+    limits = &features[active];
+
+    result = toleranceClassify(value, standard, &deviation);
+
+    switch (result) {
+        case TOLERANCE_LOW:
+            spc.low++;
+            bin = 0;
+            break;
+        case TOLERANCE_HIGH:
+            spc.high++;
+            bin = TOLERANCE_BINS - 1;
+            break;
+        case TOLERANCE_PASS:
+            bin = 1 + (int)(((int64_t)(deviation - limits->lower) *
+                             CONFIG_CALIPER_TOLERANCE_BINS) /
+                            (limits->upper - limits->lower + 1));
+            break;
+        default:
+            bin = -1;
+            break;
+    }
+
+    if (bin >= 0) {
+        spc.count++;
+        spc.sum     += deviation;
+        spc.squares += (int64_t) deviation * deviation;
+        spc.bins[bin]++;
+    }
+
+    k_mutex_unlock(&tolerance_mutex);
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Returns 0, -ENOENT without limits, or -ENODATA before any reading.       */
+/*---------------------------------------------------------------------------*/
+int tolerance_get_spc(tolerance_spc_t * result)
+{
+    const tolerance_limits_t * limits;
+    int64_t  mean;       // Q16
+    int64_t  variance;   // Q16
+    uint32_t sigma;      // Q8
+    int64_t  margin;
+    int      ret = 0;
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+
+    limits = &features[active];
+
+    if (!limits->defined) {
+        ret = -ENOENT;
+    }
+    else if (spc.count == 0) {
+        ret = -ENODATA;
+    }
+    else {
+        memset(result, 0, sizeof(*result));
+
+        result->count = spc.count;
+        result->low   = spc.low;
+        result->high  = spc.high;
+        memcpy(result->bins, spc.bins, sizeof(result->bins));
+
+        mean = fixed_div_round(spc.sum << 16, spc.count);
+        variance = (spc.count > 1) ?
+                   ((spc.squares << 16) - mean * spc.sum) / (spc.count - 1) :
+                   0;
+        sigma = fixed_sqrt(MAX(variance, 0));
+
+        result->mean   = (int32_t) fixed_div_round(mean, 1 << 16);
+        result->stddev = (int32_t) fixed_div_round(sigma, 1 << 8);
+
+        if (sigma > 0) {
+            result->cp = (int32_t)
+                (((int64_t)(limits->upper - limits->lower) << 8) * 1000 /
+                 (6 * (int64_t) sigma));
+
+            margin = MIN(((int64_t) limits->upper << 16) - mean,
+                         mean - ((int64_t) limits->lower << 16));
+            result->cpk = (int32_t)
+                (margin * 1000 / (3 * ((int64_t) sigma << 8)));
+        }
+    }
+
+    k_mutex_unlock(&tolerance_mutex);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start a new SPC session.                                                 */
+/*---------------------------------------------------------------------------*/
+void tolerance_reset(void)
+{
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+    memset(&spc, 0, sizeof(spc));
+    k_mutex_unlock(&tolerance_mutex);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Store a feature's limits (defined false to clear them).                  */
+/*---------------------------------------------------------------------------*/
+int tolerance_set(int feature, const tolerance_limits_t * limits)
+{
+    char name [16];
+
+    if (feature < 0 || feature >= TOLERANCE_FEATURES ||
+        (limits->defined && limits->lower > limits->upper)) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+    features[feature] = *limits;
+    if (feature == active) {
+        memset(&spc, 0, sizeof(spc));
+    }
+    k_mutex_unlock(&tolerance_mutex);
+
+    snprintf(name, sizeof(name), "tol/%d", feature);
+
+    return settings_save_one(name, limits, sizeof(*limits));
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int tolerance_get(int feature, tolerance_limits_t * limits)
+{
+    if (feature < 0 || feature >= TOLERANCE_FEATURES) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+    *limits = features[feature];
+    k_mutex_unlock(&tolerance_mutex);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Make feature the active one; a new SPC session starts.                   */
+/*---------------------------------------------------------------------------*/
+int tolerance_select(int feature)
+{
+    if (feature < 0 || feature >= TOLERANCE_FEATURES) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&tolerance_mutex, K_FOREVER);
+    active = feature;
+    memset(&spc, 0, sizeof(spc));
+    k_mutex_unlock(&tolerance_mutex);
+
+    return settings_save_one("tol/active", &active, sizeof(active));
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int tolerance_active(void)
+{
+    return active;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Thousandths as [-]int.frac                                               */
+/*---------------------------------------------------------------------------*/
+static void toleranceIndex(char * buffer, size_t size, int32_t milli)
+{
+    snprintf(buffer, size, "%s%d.%03d", (milli < 0) ? "-" : "",
+             abs(milli) / 1000, abs(milli) % 1000);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Keystrokes for the SPC summary, one row:                                 */
+/*      count TAB low TAB high TAB mean TAB stddev TAB Cp TAB Cpk ENTER      */
+/*  Returns the number of keys, or -ENOENT / -ENODATA / -ENOSPC.             */
+/*---------------------------------------------------------------------------*/
+int tolerance_render(keyboard_key_t * keys, int size)
+{
+    tolerance_spc_t   result;
+    tolerance_limits_t limits;
+    char  text [7][16];
+    const char * cells [7];
+    int   ret;
+
+    ret = tolerance_get_spc(&result);
+    if (ret != 0) {
+        return ret;
+    }
+    tolerance_get(active, &limits);
+
+    snprintf(text[0], sizeof(text[0]), "%u", result.count);
+    snprintf(text[1], sizeof(text[1]), "%u", result.low);
+    snprintf(text[2], sizeof(text[2]), "%u", result.high);
+    format_value(text[3], sizeof(text[3]), limits.nominal + result.mean,
+                 limits.standard, FORMAT_DECIMALS_ALL);
+    format_value(text[4], sizeof(text[4]), result.stddev,
+                 limits.standard, FORMAT_DECIMALS_ALL);
+    toleranceIndex(text[5], sizeof(text[5]), result.cp);
+    toleranceIndex(text[6], sizeof(text[6]), result.cpk);
+
+    for (int i=0; i < ARRAY_SIZE(cells); i++) {
+        cells[i] = text[i];
+    }
+
+    return output_cells(cells, ARRAY_SIZE(cells), keys, size);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Load limits from settings.                                               */
+/*---------------------------------------------------------------------------*/
+void tolerance_init(void)
+{
+    store_table_load(&tolerance_store);
+
+    if (active < 0 || active >= TOLERANCE_FEATURES) {
+        active = 0;
+    }
+
+    LOG_INF("%s: feature %d of %d, limits %s", __func__, active,
+            TOLERANCE_FEATURES, features[active].defined ? "set" : "none");
+}
@@ -68,3 +68,20 @@ buzzer_play_t error_sound [] = {
     {.action = BUZZER_PLAY_QUIET, .duration=200},   // short quiet
     {.action = BUZZER_PLAY_DONE,  .duration=0},     // stop
 };
+
+buzzer_play_t tolerance_pass_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration=60},    // chirp        60ms
+    {.action = BUZZER_PLAY_DONE,  .duration=0},     // stop
+};
+
+buzzer_play_t tolerance_low_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration=100},   // short buzz   100ms
+    {.action = BUZZER_PLAY_QUIET, .duration=100},   // short quiet
+    {.action = BUZZER_PLAY_TONE,  .duration=100},   // short buzz
+    {.action = BUZZER_PLAY_DONE,  .duration=0},     // stop
+};
+
+buzzer_play_t tolerance_high_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration=600},   // long buzz    600ms
+    {.action = BUZZER_PLAY_DONE,  .duration=0},     // stop
+};
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  units.c  -- Units policy: report in mm, in inch, or as the caliper does
+ *
+ *  Readings are counts of 0.001 mm or 0.00001 inch (see caliper.h), and
+ *  1 inch is exactly 25.4 mm = 127/5 mm, so
+ *
+ *      mm counts   = inch counts * 127 / 500
+ *      inch counts = mm counts   * 500 / 127
+ *
+ *  Conversion is done in 64-bit integers and rounded once, half away
+ *  from zero, to the target count.  The result is within half a count
+ *  (0.5 um, or 0.127 um) of the exact value, finer than the step of any
+ *  decoder except digimatic in inch mode (0.254 um), so converted readings
+ *  keep the source resolution; output rounding is left to format.c.
+ */
+#include <zephyr/kernel.h>
+
+#include "units.h"
+#include "caliper.h"
+#include "fixed.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(units, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static atomic_t policy = ATOMIC_INIT(AS_CALIPER);
+
+/*---------------------------------------------------------------------------*/
+/*  Reading counts in from_standard to counts in to_standard.                */
+/*---------------------------------------------------------------------------*/
+int32_t units_convert(int32_t value, int from_standard, int to_standard)
+{
+    if (from_standard == to_standard) {
+        return value;
+    }
+    if (to_standard == CALIPER_STANDARD_MM) {
+        return (int32_t) fixed_div_round((int64_t) value * 127, 500);
+    }
+    return (int32_t) fixed_div_round((int64_t) value * 500, 127);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Convert a reading in place to the units the policy asks for.             */
+/*---------------------------------------------------------------------------*/
+void units_apply(caliper_reading_t * reading)
+{
+    int target;
+
+    switch (atomic_get(&policy)) {
+        case ALWAYS_MM:   target = CALIPER_STANDARD_MM;   break;
+        case ALWAYS_INCH: target = CALIPER_STANDARD_INCH; break;
+        default:          return;
+    }
+
+    reading->value    = units_convert(reading->value, reading->standard,
+                                      target);
+    reading->standard = target;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+units_t units_get_policy(void)
+{
+    return (units_t) atomic_get(&policy);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Takes effect from the next reading, and is kept in UICR.                 */
+/*---------------------------------------------------------------------------*/
+void units_set_policy(units_t units)
+{
+    atomic_set(&policy, units);
+
+    if (app_uicr_get_units() != units) {
+        app_uicr_set_units(units);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  After app_uicr_init().                                                   */
+/*---------------------------------------------------------------------------*/
+void units_init(void)
+{
+    atomic_set(&policy, app_uicr_get_units());
+
+    LOG_INF("%s: policy %d", __func__, (int) atomic_get(&policy));
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2023 Callender-Consulting
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ *  validate.c  -- Multi-frame validation of decoded readings
+ *
+ *  A frame that decodes is not necessarily right: one flipped bit on a
+ *  noisy cable still makes a number.  Before a reading is published:
+ *   - plausibility: against the last accepted reading of the channel,
+ *     the jaw can not have moved faster than CALIPER_VALIDATE_MAX_SPEED.
+ *     A genuine jump is accepted once a second frame agrees with it.
+ *   - agreement (optional): N of the last M back-to-back frames must
+ *     show the same value.
+ *  The result goes into the reading's flags.  Reserved frame bits are
+ *  checked earlier, by the decoder.
+ */
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "validate.h"
+#include "caliper.h"
+#include "caliper_gpio.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(validate, LOG_LEVEL_INF);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define VOTE_N      CONFIG_CALIPER_VALIDATE_VOTE_N
+#define VOTE_M      CONFIG_CALIPER_VALIDATE_VOTE_M
+
+BUILD_ASSERT(VOTE_N <= VOTE_M, "vote needs N <= M");
+
+/* Frames further apart than this are not back-to-back (caliper was off). */
+#define VALIDATE_STALE_US     500000
+
+typedef struct {
+    int32_t   value;
+    uint8_t   standard;
+    int64_t   timestamp;
+    bool      valid;
+} validate_ref_t;
+
+typedef struct {
+    validate_ref_t  good;        // last accepted reading
+    validate_ref_t  candidate;   // last implausible one, may be a real jump
+
+    validate_ref_t  window [VOTE_M];
+    int             next;
+    int             count;
+} validate_channel_t;
+
+static validate_channel_t channels [CALIPER_CHANNELS];
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void validateRemember(validate_ref_t * ref, const caliper_reading_t * reading)
+{
+    ref->value     = reading->value;
+    ref->standard  = reading->standard;
+    ref->timestamp = reading->timestamp;
+    ref->valid     = true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Could the jaw have got from ref to reading in the time between?          */
+/*---------------------------------------------------------------------------*/
+static bool validatePlausible(const validate_ref_t * ref,
+                              const caliper_reading_t * reading)
+{
+    int64_t  dt_us;
+    int64_t  limit;
+
+    if (!ref->valid || ref->standard != reading->standard) {
+        return true;    // nothing to compare with, or units switched
+    }
+
+    dt_us = k_ticks_to_us_floor64(reading->timestamp - ref->timestamp);
+    if (dt_us > VALIDATE_STALE_US) {
+        return true;
+    }
+
+    /*
+     *  Travel at the maximum speed, in reading counts (mm/s * us is nm):
+     *  nm / 1000 in 0.001 mm, or nm / 254 in 0.00001 inch.
+     */
+    if (reading->standard == CALIPER_STANDARD_MM) {
+        limit = (CONFIG_CALIPER_VALIDATE_MAX_SPEED * dt_us) / 1000;
+    }
+    else {
+        limit = (CONFIG_CALIPER_VALIDATE_MAX_SPEED * dt_us) / 254;
+    }
+    limit += CALIPER_UM_TO_COUNTS(CONFIG_CALIPER_VALIDATE_SLACK,
+                                  reading->standard);
+
+    return (llabs((int64_t) reading->value - ref->value) <= limit);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  N of the last M back-to-back frames agree with this one?                 */
+/*---------------------------------------------------------------------------*/
+static bool validateVote(validate_channel_t * ch, const caliper_reading_t * reading)
+{
+    const validate_ref_t * last;
+    int agree = 0;
+    int i;
+
+    if (ch->count > 0) {
+        last = &ch->window[(ch->next + VOTE_M - 1) % VOTE_M];
+        if (last->standard != reading->standard ||
+            k_ticks_to_us_floor64(reading->timestamp - last->timestamp) > 
+                                                      VALIDATE_STALE_US) {
+            ch->count = 0;
+        }
+    }
+
+    validateRemember(&ch->window[ch->next], reading);
+    ch->next = (ch->next + 1) % VOTE_M;
+    ch->count = MIN(ch->count + 1, VOTE_M);
+
+    for (i=0; i < ch->count; i++) {
+        const validate_ref_t * ref = &ch->window[(ch->next + VOTE_M - 1 - i) % VOTE_M];
+
+        if (abs(ref->value - reading->value) <=
+            CALIPER_UM_TO_COUNTS(CONFIG_CALIPER_VALIDATE_VOTE_TOLERANCE,
+                                 reading->standard)) {
+            agree++;
+        }
+    }
+
+    return (agree >= VOTE_N);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Judge one decoded reading and set its quality flags.                     */
+/*  Returns 0 when it may be published (READING_FLAG_VALID), -ERANGE if it   */
+/*  is implausible, -EINPROGRESS while the vote needs more frames.           */
+/*---------------------------------------------------------------------------*/
+int validate_reading(caliper_reading_t * reading)
+{
+    validate_channel_t * ch = &channels[reading->channel];
+
+    reading->flags = 0;
+
+    if (!validatePlausible(&ch->good, reading)) {
+
+        /*
+         *  Two frames in a row that agree with each other are a real
+         *  jump (frames were missed, or the caliper was re-zeroed).
+         */
+        if (!ch->candidate.valid || !validatePlausible(&ch->candidate, reading)) {
+            validateRemember(&ch->candidate, reading);
+            reading->flags = READING_FLAG_REJECTED;
+            LOG_DBG("%d: implausible %d", reading->channel, reading->value);
+            return -ERANGE;
+        }
+    }
+    ch->candidate.valid = false;
+
+    if (VOTE_M > 1 && !validateVote(ch, reading)) {
+        reading->flags = READING_FLAG_PENDING;
+        return -EINPROGRESS;
+    }
+
+    validateRemember(&ch->good, reading);
+
+    reading->flags = READING_FLAG_VALID;
+    if (VOTE_N > 1) {
+        reading->flags |= READING_FLAG_VOTED;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Forget the channel's history, e.g. after a protocol change.              */
+/*---------------------------------------------------------------------------*/
+void validate_reset(int channel)
+{
+    memset(&channels[channel], 0, sizeof(channels[channel]));
+}